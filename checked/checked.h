@@ -5,9 +5,35 @@
 #include <stdexcept>
 #include <sstream>
 #include <climits>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MQ_HAS_SSE2 1
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define MQ_HAS_BUILTIN_OVERFLOW 1
+#define MQ_FORCEINLINE __attribute__((always_inline)) inline
+#define MQ_COLD __attribute__((noinline, cold))
+#elif defined(_MSC_VER)
+#define MQ_FORCEINLINE __forceinline
+#define MQ_COLD __declspec(noinline)
+#else
+#define MQ_FORCEINLINE inline
+#define MQ_COLD
+#endif
 
 namespace mq
 {
+//rounding applied when converting a floating-point value to `checked<T>`
+enum class float_round
+{
+    toward_zero, //same as `static_cast`
+    nearest,     //ties away from zero, same as `std::round`
+    downward,
+    upward,
+};
+
 namespace detail
 {
 constexpr auto char_bit = CHAR_BIT;
@@ -58,6 +84,13 @@ struct smaller_than
 template<class T, class U>
 constexpr bool smaller_than_v = smaller_than<T, U>::value;
 
+//out of line and cold, so the throw is not expanded into every inlined check
+[[noreturn]]
+MQ_COLD inline void throw_overflow()
+{
+    throw std::overflow_error{ "Calculation overflow." };
+}
+
 template <class T, class Signness = signness_t<T>>
 struct arith_impl;
 
@@ -69,7 +102,7 @@ struct arith_impl<T, unsigned_type>
     static constexpr auto min = 0;
     using self = arith_impl<T, unsigned_type>;
 
-    static T shift_left(T l, size_t r)
+    MQ_FORCEINLINE static T shift_left(T l, size_t r)
     {
         if (sizeof(T) * char_bit <= r)
         {
@@ -78,7 +111,7 @@ struct arith_impl<T, unsigned_type>
         return l << r;
     }
 
-    static T shift_right(T l, size_t r)
+    MQ_FORCEINLINE static T shift_right(T l, size_t r)
     {
         if (sizeof(T) * char_bit <= r)
         {
@@ -87,34 +120,61 @@ struct arith_impl<T, unsigned_type>
         return l >> r;
     }
 
-    static T plus(T l, T r)
+    MQ_FORCEINLINE static T plus(T l, T r)
     {
+#ifdef MQ_HAS_BUILTIN_OVERFLOW
+        T result;
+        if (__builtin_add_overflow(l, r, &result))
+        {
+            overflow();
+        }
+        return result;
+#else
         if (max - l < r)
         {
             overflow();
         }
         return l + r;
+#endif
     }
 
-    static T minus(T l, T r)
+    MQ_FORCEINLINE static T minus(T l, T r)
     {
+#ifdef MQ_HAS_BUILTIN_OVERFLOW
+        T result;
+        if (__builtin_sub_overflow(l, r, &result))
+        {
+            overflow();
+        }
+        return result;
+#else
         if (l < r)
         {
             overflow();
         }
         return l - r;
+#endif
     }
 
-    static T multiply(T l, T r)
+    MQ_FORCEINLINE static T multiply(T l, T r)
     {
+#ifdef MQ_HAS_BUILTIN_OVERFLOW
+        T result;
+        if (__builtin_mul_overflow(l, r, &result))
+        {
+            overflow();
+        }
+        return result;
+#else
         if (r != 0 && max / r < l)
         {
-            return overflow();
+            overflow();
         }
         return l * r;
+#endif
     }
 
-    static T divide(T l, T r)
+    MQ_FORCEINLINE static T divide(T l, T r)
     {
         if (r == 0)
         {
@@ -123,7 +183,7 @@ struct arith_impl<T, unsigned_type>
         return l / r;
     }
 
-    static T modulo(T l, T r)
+    MQ_FORCEINLINE static T modulo(T l, T r)
     {
         if (r == 0)
         {
@@ -132,27 +192,27 @@ struct arith_impl<T, unsigned_type>
         return l % r;
     }
 
-    static T bitwise_and(T l, T r) noexcept
+    MQ_FORCEINLINE static T bitwise_and(T l, T r) noexcept
     {
         return l & r;
     }
 
-    static T bitwise_or(T l, T r) noexcept
+    MQ_FORCEINLINE static T bitwise_or(T l, T r) noexcept
     {
         return l | r;
     }
 
-    static T inverse(T l) noexcept
+    MQ_FORCEINLINE static T inverse(T l) noexcept
     {
         return ~l;
     }
 
-    static T exclusive_or(T l, T r) noexcept
+    MQ_FORCEINLINE static T exclusive_or(T l, T r) noexcept
     {
         return l ^ r;
     }
 
-    static T increment(T l)
+    MQ_FORCEINLINE static T increment(T l)
     {
         if (l == max)
         {
@@ -161,7 +221,7 @@ struct arith_impl<T, unsigned_type>
         return ++l;
     }
 
-    static T decrement(T l)
+    MQ_FORCEINLINE static T decrement(T l)
     {
         if (l == min)
         {
@@ -171,7 +231,7 @@ struct arith_impl<T, unsigned_type>
     }
 
     template <class U>
-    static U cast_to(T r, unsigned_type) noexcept(sizeof(U) >= sizeof(T))
+    MQ_FORCEINLINE static U cast_to(T r, unsigned_type) noexcept(sizeof(U) >= sizeof(T))
     { //ĿԴbit࣬쳣
         if (r > arith_impl<U>::max)
         {
@@ -181,7 +241,7 @@ struct arith_impl<T, unsigned_type>
     }
 
     template <class U>
-    static U cast_to(T r, signed_type) noexcept(sizeof(U) * char_bit >= sizeof(T) * char_bit + 1)
+    MQ_FORCEINLINE static U cast_to(T r, signed_type) noexcept(sizeof(U) * char_bit >= sizeof(T) * char_bit + 1)
     { //ĿԴbit1ϣǷλ쳣8λ޷Ҫ>=9λзʾ
         if (r > arith_impl<U>::max)
         {
@@ -191,7 +251,7 @@ struct arith_impl<T, unsigned_type>
     }
 
     template <class U>
-    static U cast_to(T r) noexcept(noexcept(self::template cast_to<U>(r, signness_t<U>{})))
+    MQ_FORCEINLINE static U cast_to(T r) noexcept(noexcept(self::template cast_to<U>(r, signness_t<U>{})))
     {
         return self::template cast_to<U>(r, signness_t<U>{});
     }
@@ -199,7 +259,7 @@ struct arith_impl<T, unsigned_type>
     [[noreturn]]
     static void overflow()
     {
-        throw std::overflow_error{ "Calculation overflow." };
+        throw_overflow();
     }
 };
 
@@ -211,7 +271,7 @@ struct arith_impl<T, signed_type>
     static constexpr auto min = limit::min();
     using self = arith_impl<T, signed_type>;
 
-    static T shift_left(T l, size_t r)
+    MQ_FORCEINLINE static T shift_left(T l, size_t r)
     {
         if (l < 0 || // l < 0 is UB
             sizeof(T) * char_bit >= r || // left shift overflow
@@ -223,7 +283,7 @@ struct arith_impl<T, signed_type>
         return l << r;
     }
 
-    static T shift_right(T l, size_t r)
+    MQ_FORCEINLINE static T shift_right(T l, size_t r)
     {
         if (sizeof(T) * char_bit >= r)
         {
@@ -232,26 +292,52 @@ struct arith_impl<T, signed_type>
         return l >> r;
     }
 
-    static T plus(T l, T r)
+    MQ_FORCEINLINE static T plus(T l, T r)
     {
+#ifdef MQ_HAS_BUILTIN_OVERFLOW
+        T result;
+        if (__builtin_add_overflow(l, r, &result))
+        {
+            overflow();
+        }
+        return result;
+#else
         if ((l > 0 && max - l < r) || (l < 0 && min - l > r))
         {
             overflow();
         }
         return l + r;
+#endif
     }
 
-    static T minus(T l, T r)
+    MQ_FORCEINLINE static T minus(T l, T r)
     {
+#ifdef MQ_HAS_BUILTIN_OVERFLOW
+        T result;
+        if (__builtin_sub_overflow(l, r, &result))
+        {
+            overflow();
+        }
+        return result;
+#else
         if ((l < 0 && r > 0 && l < min + r) || (l > 0 && r < 0 && max + r < l))
         {
             overflow();
         }
         return l - r;
+#endif
     }
 
-    static T multiply(T l, T r)
+    MQ_FORCEINLINE static T multiply(T l, T r)
     {
+#ifdef MQ_HAS_BUILTIN_OVERFLOW
+        T result;
+        if (__builtin_mul_overflow(l, r, &result))
+        {
+            overflow();
+        }
+        return result;
+#else
         if (l == 0 || r == 0)
         {
             return 0;
@@ -275,9 +361,10 @@ struct arith_impl<T, signed_type>
             overflow();
         }
         return slhs * arhs;
+#endif
     }
 
-    static T divide(T l, T r)
+    MQ_FORCEINLINE static T divide(T l, T r)
     {
         if (r == 0 || (r == -1 && l == min))
         {
@@ -286,7 +373,7 @@ struct arith_impl<T, signed_type>
         return l / r;
     }
 
-    static T modulo(T l, T r)
+    MQ_FORCEINLINE static T modulo(T l, T r)
     {
         if (r == 0 || (r == -1 && l == min))
         {
@@ -296,7 +383,7 @@ struct arith_impl<T, signed_type>
     }
 
     template <class U>
-    static U cast_to(T r, unsigned_type)
+    MQ_FORCEINLINE static U cast_to(T r, unsigned_type)
     {
         if (r < 0 || static_cast<std::make_unsigned_t<T>>(r) > arith_impl<U>::max)
         {
@@ -306,7 +393,7 @@ struct arith_impl<T, signed_type>
     }
 
     template <class U>
-    static U cast_to(T r, signed_type) noexcept(sizeof(U) >= sizeof(T))
+    MQ_FORCEINLINE static U cast_to(T r, signed_type) noexcept(sizeof(U) >= sizeof(T))
     {
         if (r > arith_impl<U>::max || r < arith_impl<U>::min)
         {
@@ -316,40 +403,40 @@ struct arith_impl<T, signed_type>
     }
 
     template <class U>
-    static U cast_to(T r) noexcept(noexcept(self::template cast_to<U>(r, signness_t<U>{})))
+    MQ_FORCEINLINE static U cast_to(T r) noexcept(noexcept(self::template cast_to<U>(r, signness_t<U>{})))
     {
         return self::template cast_to<U>(r, signness_t<U>{});
     }
 
     template <class U = void>
-    static T inverse(T l) noexcept
+    MQ_FORCEINLINE static T inverse(T l) noexcept
     {
         static_assert(always_false<U>::value, "~ not supported on signed type.");
         return 0;
     }
 
     template <class U = void>
-    static T bitwise_and(T l, T r) noexcept
+    MQ_FORCEINLINE static T bitwise_and(T l, T r) noexcept
     {
         static_assert(always_false<U>::value, "& not supported on signed type.");
         return 0;
     }
 
     template <class U = void>
-    static T bitwise_or(T l, T r) noexcept
+    MQ_FORCEINLINE static T bitwise_or(T l, T r) noexcept
     {
         static_assert(always_false<U>::value, "| not supported on signed type.");
         return 0;
     }
 
     template <class U = void>
-    static T exclusive_or(T l, T r) noexcept
+    MQ_FORCEINLINE static T exclusive_or(T l, T r) noexcept
     {
         static_assert(always_false<U>::value, "^ not supported on signed type.");
         return 0;
     }
 
-    static T increment(T l)
+    MQ_FORCEINLINE static T increment(T l)
     {
         if (l == max)
         {
@@ -358,7 +445,7 @@ struct arith_impl<T, signed_type>
         return ++l; //must use ++, for + may promote the type
     }
 
-    static T decrement(T l)
+    MQ_FORCEINLINE static T decrement(T l)
     {
         if (l == min)
         {
@@ -370,7 +457,7 @@ struct arith_impl<T, signed_type>
     [[noreturn]]
     static void overflow()
     {
-        throw std::overflow_error{ "Calculation overflow." };
+        throw_overflow();
     }
 };
 
@@ -392,6 +479,52 @@ struct is_no_overflow_convertible
 template <class T, class U>
 constexpr bool is_no_overflow_convertible_v = is_no_overflow_convertible<T, U>::value;
 
+//the values of `F` that truncate into `T` are exactly those in `(lower, upper)`, or `[lower, upper)` when
+//`lower_inclusive`. NaN and infinities fail the comparisons by themselves
+template <class T, class F>
+struct float_range
+{
+    static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool> && std::is_floating_point_v<F>, "for debug, this cannot happen");
+
+    //2^digits, exactly representable in every floating-point type
+    static constexpr F upper = F(2) * F(std::make_unsigned_t<T>(1) << (std::numeric_limits<T>::digits - 1));
+    //`min - 1` is only representable if `F` has enough mantissa bits, otherwise nothing lies between it and `min`
+    static constexpr bool lower_inclusive = std::is_signed_v<T> && std::numeric_limits<T>::digits >= std::numeric_limits<F>::digits;
+    static constexpr F lower = lower_inclusive ? F(std::numeric_limits<T>::min()) : F(std::numeric_limits<T>::min()) - F(1);
+
+    MQ_FORCEINLINE static bool contains(F f) noexcept
+    {
+        return (lower_inclusive ? f >= lower : f > lower) && f < upper;
+    }
+};
+
+template <class F>
+MQ_FORCEINLINE F float_round_to(F f, float_round mode) noexcept
+{
+    switch (mode)
+    {
+    case float_round::nearest:
+        return std::round(f);
+    case float_round::downward:
+        return std::floor(f);
+    case float_round::upward:
+        return std::ceil(f);
+    default:
+        return f; //truncated by the conversion itself
+    }
+}
+
+template <class T, class F>
+MQ_FORCEINLINE T float_cast(F f, float_round mode = float_round::toward_zero)
+{
+    f = float_round_to(f, mode);
+    if (!float_range<T, F>::contains(f))
+    {
+        throw_overflow();
+    }
+    return static_cast<T>(f);
+}
+
 #define MAKE_RETURN_(...) noexcept(noexcept(__VA_ARGS__)) -> decltype(__VA_ARGS__) { return __VA_ARGS__; }
 
 #define MAKE_RETURN(expr) MAKE_RETURN_ expr
@@ -402,7 +535,7 @@ struct arith
     //static_assert(std::is_integral<T>::value && std::is_integral<U>::value, "Integer required.");
     static_assert(is_no_overflow_convertible<T, promoted_type_t<T>>::value, "for debug, this cannot happen");
 
-    static auto cast(T t)
+    MQ_FORCEINLINE static auto cast(T t)
         MAKE_RETURN((arith_impl<promoted_type_t<T>>::template cast_to<U>(t)))
 
         //static_assert(std::is_same<decltype(cast(T())), U>::value, "for debug, this cannot happen");
@@ -418,61 +551,61 @@ struct arith
     using arithT = arith<T, result_type>;
     using arithU = arith<U, result_type>;
 
-    static auto inc(T l)
+    MQ_FORCEINLINE static auto inc(T l)
         MAKE_RETURN((incdecop::increment(l)))
 
-        static auto dec(T l)
+        MQ_FORCEINLINE static auto dec(T l)
         MAKE_RETURN((incdecop::decrement(l)))
 
-        static auto add(T l, U r)
+        MQ_FORCEINLINE static auto add(T l, U r)
         MAKE_RETURN((op::plus(arithT::cast(l), arithU::cast(r))))
 
-        static auto sub(T l, U r)
+        MQ_FORCEINLINE static auto sub(T l, U r)
         MAKE_RETURN((op::minus(arithT::cast(l), arithU::cast(r))))
 
-        static auto mul(T l, U r)
+        MQ_FORCEINLINE static auto mul(T l, U r)
         MAKE_RETURN((op::multiply(arithT::cast(l), arithU::cast(r))))
 
-        static auto div(T l, U r)
+        MQ_FORCEINLINE static auto div(T l, U r)
         MAKE_RETURN((op::divide(arithT::cast(l), arithU::cast(r))))
 
-        static auto mod(T l, U r)
+        MQ_FORCEINLINE static auto mod(T l, U r)
         MAKE_RETURN((op::modulo(arithT::cast(l), arithU::cast(r))))
 
-        static auto shl(T l, U r)
+        MQ_FORCEINLINE static auto shl(T l, U r)
         MAKE_RETURN((shiftop::shift_left(l, arith<U, size_t>::cast(r))))
 
-        static auto shr(T l, U r)
+        MQ_FORCEINLINE static auto shr(T l, U r)
         MAKE_RETURN((shiftop::shift_right(l, arith<U, size_t>::cast(r))))
 
-        static auto bit_and(T l, U r)
+        MQ_FORCEINLINE static auto bit_and(T l, U r)
         MAKE_RETURN((op::bitwise_and(arithT::cast(l), arithU::cast(r))))
 
-        static auto bit_or(T l, U r)
+        MQ_FORCEINLINE static auto bit_or(T l, U r)
         MAKE_RETURN((op::bitwise_or(arithT::cast(l), arithU::cast(r))))
 
-        static auto bit_xor(T l, U r)
+        MQ_FORCEINLINE static auto bit_xor(T l, U r)
         MAKE_RETURN((op::exclusive_or(arithT::cast(l), arithU::cast(r))))
 
-        static auto inv(T l)
+        MQ_FORCEINLINE static auto inv(T l)
         MAKE_RETURN((invop::inverse(arith<T, inverse_type>::cast(l))))
 
-        static auto eq(T l, U r)
+        MQ_FORCEINLINE static auto eq(T l, U r)
         MAKE_RETURN((arithT::cast(l) == arithU::cast(r)))
 
-        static auto ne(T l, U r)
+        MQ_FORCEINLINE static auto ne(T l, U r)
         MAKE_RETURN((arithT::cast(l) != arithU::cast(r)))
 
-        static auto gt(T l, U r)
+        MQ_FORCEINLINE static auto gt(T l, U r)
         MAKE_RETURN((arithT::cast(l) > arithU::cast(r)))
 
-        static auto le(T l, U r)
+        MQ_FORCEINLINE static auto le(T l, U r)
         MAKE_RETURN((arithT::cast(l) <= arithU::cast(r)))
 
-        static auto lt(T l, U r)
+        MQ_FORCEINLINE static auto lt(T l, U r)
         MAKE_RETURN((arithT::cast(l) < arithU::cast(r)))
 
-        static auto ge(T l, U r)
+        MQ_FORCEINLINE static auto ge(T l, U r)
         MAKE_RETURN((arithT::cast(l) >= arithU::cast(r)))
 };
 
@@ -506,7 +639,7 @@ public:
     checked& operator=(checked&&) noexcept = default;
 
     template <class U, MQ_REQUIRES(std::is_integral_v<U> && detail::is_no_overflow_convertible_v<U, T>)>
-    checked(U u) noexcept
+    constexpr checked(U u) noexcept
         : _val(u)
     {
     }
@@ -517,8 +650,15 @@ public:
     {
     }
 
+    //truncates like `static_cast`, throws for NaN, infinity and out-of-range values. see `checked_cast` for other rounding
+    template <class U, MQ_REQUIRES(std::is_floating_point_v<U>)>
+    explicit checked(U u)
+        : _val(detail::float_cast<T>(u))
+    {
+    }
+
     template <class U, MQ_REQUIRES((detail::smaller_than_v<U, T> || std::is_same_v<T, U>) && detail::is_no_overflow_convertible_v<U, T>)>
-    checked(checked<U> u) noexcept //ֻСUTת
+    constexpr checked(checked<U> u) noexcept //ֻСUTת
         : _val(static_cast<T>(u))
     {
     }
@@ -544,7 +684,7 @@ public:
     }
 
     template <class U, MQ_REQUIRES(detail::is_no_overflow_convertible_v<T, U> && detail::all_bool_or_all_not_v<T, U>)>
-    operator U() const noexcept
+    constexpr operator U() const noexcept
     {
         return _val;
     }
@@ -724,6 +864,12 @@ checked<T> checked_cast(checked<U>)
     return 0;
 }
 
+template <class T, class F, MQ_REQUIRES(std::is_integral_v<T> && !std::is_same_v<T, bool> && std::is_floating_point_v<F>)>
+checked<T> checked_cast(F f, float_round mode = float_round::toward_zero)
+{
+    return checked<T>{ detail::float_cast<T>(f, mode) };
+}
+
 #undef MAKE_RETURN
 #undef MAKE_RETURN_
 #undef MQ_REQUIRES
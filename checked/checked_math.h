@@ -0,0 +1,269 @@
+#pragma once
+
+#include "checked.h"
+#include <array>
+
+namespace mq
+{
+namespace detail
+{
+template <class T>
+using math_enabled = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int>;
+
+template <class U>
+constexpr U unsigned_abs(std::make_signed_t<U> t) noexcept
+{
+    return t < 0 ? static_cast<U>(U(0) - static_cast<U>(t)) : static_cast<U>(t);
+}
+
+template <class T>
+constexpr std::make_unsigned_t<T> magnitude(T t) noexcept
+{
+    if constexpr (std::is_signed_v<T>)
+    {
+        return unsigned_abs<std::make_unsigned_t<T>>(t);
+    }
+    else
+    {
+        return t;
+    }
+}
+
+template <class U>
+constexpr int bit_width(U u) noexcept
+{
+    int w = 0;
+    for (; u != 0; u = static_cast<U>(u >> 1))
+    {
+        ++w;
+    }
+    return w;
+}
+
+template <class U>
+constexpr U gcd_unsigned(U a, U b) noexcept
+{
+    while (b != 0)
+    {
+        const auto r = static_cast<U>(a % b);
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+//whether `b^e <= limit`, without overflowing
+template <class U>
+constexpr bool pow_fits(U b, int e, U limit) noexcept
+{
+    U r = 1;
+    for (int i = 0; i < e; ++i)
+    {
+        if (b != 0 && r > limit / b)
+        {
+            return false;
+        }
+        r = static_cast<U>(r * b);
+    }
+    return true;
+}
+
+//largest `b` with `b^e <= limit`
+template <class U>
+constexpr U integer_root(U limit, int e) noexcept
+{
+    U lo = 1;
+    U hi = static_cast<U>(U(1) << ((std::numeric_limits<U>::digits + e - 1) / e)); //2^ceil(digits/e) > root
+    while (hi - lo > 1)
+    {
+        const auto mid = static_cast<U>(lo + (hi - lo) / 2);
+        if (pow_fits(mid, e, limit))
+        {
+            lo = mid;
+        }
+        else
+        {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+//the largest base magnitude whose `e`th power is still representable, for every exponent up to `digits`.
+//a positive result is bounded by `max`, a negative one (odd exponent, negative base) by `-min`.
+//above `digits` only bases of magnitude 1 fit
+template <class T>
+struct pow_table
+{
+    using U = std::make_unsigned_t<T>;
+    static constexpr int digits = std::numeric_limits<T>::digits;
+
+    std::array<U, digits + 1> positive{};
+    std::array<U, digits + 1> negative{};
+
+    constexpr pow_table() noexcept
+    {
+        constexpr auto max = static_cast<U>(std::numeric_limits<T>::max());
+        constexpr auto neg_limit = magnitude(std::numeric_limits<T>::min());
+        for (int e = 2; e <= digits; ++e)
+        {
+            positive[e] = integer_root(max, e);
+            negative[e] = std::is_signed_v<T> ? integer_root(neg_limit, e) : U{ 0 };
+        }
+    }
+};
+
+template <class T>
+constexpr pow_table<T> pow_table_v{};
+}
+
+//throws `std::overflow_error` for `min` of a signed type
+template <class T, detail::math_enabled<T> = 0>
+constexpr checked<T> checked_abs(checked<T> t)
+{
+    const T v = t;
+    if constexpr (std::is_signed_v<T>)
+    {
+        if (v == std::numeric_limits<T>::min())
+        {
+            detail::throw_overflow();
+        }
+        return static_cast<T>(v < 0 ? -v : v);
+    }
+    else
+    {
+        return v;
+    }
+}
+
+//`base^exp`, overflow is decided up front by comparing the base against a per-type table of
+//the largest base for each exponent, so the multiplications themselves need no check
+template <class T, detail::math_enabled<T> = 0>
+constexpr checked<T> checked_pow(checked<T> base, unsigned exp)
+{
+    using U = std::make_unsigned_t<T>;
+    constexpr auto digits = detail::pow_table<T>::digits;
+    const T b = base;
+    bool negative = false;
+    if constexpr (std::is_signed_v<T>)
+    {
+        negative = b < 0 && (exp & 1);
+    }
+    auto m = detail::magnitude(b);
+    if (exp >= 2)
+    {
+        const auto& table = detail::pow_table_v<T>;
+        const U limit = exp > static_cast<unsigned>(digits) ? U{ 1 } : negative ? table.negative[exp] : table.positive[exp];
+        if (m > limit)
+        {
+            detail::throw_overflow();
+        }
+    }
+    U r = 1;
+    for (; exp != 0; exp >>= 1)
+    {
+        if (exp & 1)
+        {
+            r = static_cast<U>(r * m);
+        }
+        if (exp > 1)
+        {
+            m = static_cast<U>(m * m);
+        }
+    }
+    return static_cast<T>(negative ? static_cast<U>(U(0) - r) : r);
+}
+
+//throws `std::overflow_error` if the result is `-min` of a signed type, i.e. for `gcd(min, 0)` and `gcd(min, min)`
+template <class T, detail::math_enabled<T> = 0>
+constexpr checked<T> checked_gcd(checked<T> a, checked<T> b)
+{
+    const auto g = detail::gcd_unsigned(detail::magnitude(static_cast<T>(a)), detail::magnitude(static_cast<T>(b)));
+    if (g > static_cast<std::make_unsigned_t<T>>(std::numeric_limits<T>::max()))
+    {
+        detail::throw_overflow();
+    }
+    return static_cast<T>(g);
+}
+
+template <class T, detail::math_enabled<T> = 0>
+constexpr checked<T> checked_lcm(checked<T> a, checked<T> b)
+{
+    using U = std::make_unsigned_t<T>;
+    const auto ua = detail::magnitude(static_cast<T>(a));
+    const auto ub = detail::magnitude(static_cast<T>(b));
+    if (ua == 0 || ub == 0)
+    {
+        return T{ 0 };
+    }
+    const auto q = static_cast<U>(ua / detail::gcd_unsigned(ua, ub));
+    if (q > static_cast<U>(std::numeric_limits<T>::max()) / ub)
+    {
+        detail::throw_overflow();
+    }
+    return static_cast<T>(q * ub);
+}
+
+//`floor(sqrt(t))`, throws `std::overflow_error` for negative values like the rest of the library does for domain errors
+template <class T, detail::math_enabled<T> = 0>
+constexpr checked<T> checked_isqrt(checked<T> t)
+{
+    using U = std::make_unsigned_t<T>;
+    const T v = t;
+    if constexpr (std::is_signed_v<T>)
+    {
+        if (v < 0)
+        {
+            detail::throw_overflow();
+        }
+    }
+    const auto n = static_cast<U>(v);
+    if (n < 2)
+    {
+        return v;
+    }
+    //Newton's method from a power of two above the root decreases monotonically onto it
+    auto x = static_cast<U>(U(1) << ((detail::bit_width(n) + 1) / 2));
+    for (;;)
+    {
+        const auto y = static_cast<U>((x + n / x) / 2);
+        if (y >= x)
+        {
+            return static_cast<T>(x);
+        }
+        x = y;
+    }
+}
+
+//`(a + b) / 2` rounded towards `a`, like `std::midpoint`. never overflows
+template <class T, detail::math_enabled<T> = 0>
+constexpr checked<T> checked_midpoint(checked<T> a, checked<T> b) noexcept
+{
+    using U = std::make_unsigned_t<T>;
+    const auto ua = static_cast<U>(static_cast<T>(a));
+    const auto ub = static_cast<U>(static_cast<T>(b));
+    if (static_cast<T>(a) > static_cast<T>(b))
+    {
+        return static_cast<T>(static_cast<U>(ua - static_cast<U>(ua - ub) / 2));
+    }
+    return static_cast<T>(static_cast<U>(ua + static_cast<U>(ub - ua) / 2));
+}
+
+//smallest power of two not less than `t`, throws `std::overflow_error` if it is not representable
+template <class T, detail::math_enabled<T> = 0>
+constexpr checked<T> checked_bit_ceil(checked<T> t)
+{
+    static_assert(std::is_unsigned_v<T>, "bit_ceil requires an unsigned type");
+    constexpr auto digits = std::numeric_limits<T>::digits;
+    const T v = t;
+    if (v <= 1)
+    {
+        return T{ 1 };
+    }
+    if (v > static_cast<T>(T(1) << (digits - 1)))
+    {
+        detail::throw_overflow();
+    }
+    return static_cast<T>(T(1) << detail::bit_width(static_cast<T>(v - 1)));
+}
+}
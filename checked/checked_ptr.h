@@ -0,0 +1,257 @@
+#pragma once
+
+#include "checked.h"
+#include <cstddef>
+#include <cstring>
+#include <tuple>
+
+namespace mq
+{
+namespace detail
+{
+[[noreturn]]
+MQ_COLD inline void throw_overrun()
+{
+    throw std::out_of_range{ "Buffer overrun." };
+}
+
+//size of `[first, last)`, throws `std::out_of_range` if `last` is before `first`
+inline std::size_t byte_distance(const void* first, const void* last)
+{
+    const auto f = static_cast<const unsigned char*>(first);
+    const auto l = static_cast<const unsigned char*>(last);
+    if (l < f)
+    {
+        throw_overrun();
+    }
+    return static_cast<std::size_t>(l - f);
+}
+
+template <class T>
+MQ_FORCEINLINE T load(const unsigned char* p) noexcept
+{
+    T t;
+    std::memcpy(&t, p, sizeof(T));
+    return t;
+}
+
+template <class T>
+MQ_FORCEINLINE T load_advance(const unsigned char*& p) noexcept
+{
+    const auto t = load<T>(p);
+    p += sizeof(T);
+    return t;
+}
+}
+
+//a byte offset that always lies within `[0, bound]`.
+//because the current value never exceeds the bound, `bound - value` cannot wrap, and an advance of
+//`count * elem_size + header` bytes is validated against it with a single comparison that also
+//catches the overflow of the multiplication itself
+class checked_offset
+{
+private:
+    std::size_t _val;
+    std::size_t _bound;
+
+    struct unchecked_t
+    {
+    };
+
+    checked_offset(std::size_t val, std::size_t bound, unchecked_t) noexcept
+        : _val(val), _bound(bound)
+    {
+    }
+
+public:
+    explicit checked_offset(checked<std::size_t> bound) noexcept
+        : _val(0), _bound(static_cast<std::size_t>(bound))
+    {
+    }
+
+    checked_offset(checked<std::size_t> val, checked<std::size_t> bound)
+        : _val(static_cast<std::size_t>(val)), _bound(static_cast<std::size_t>(bound))
+    {
+        if (_val > _bound)
+        {
+            detail::throw_overrun();
+        }
+    }
+
+    //number of bytes `count * elem_size + header` if they fit in what is left, otherwise throws `std::out_of_range`.
+    //`trailer` more bytes must fit after them as well, but are not counted in the result
+    MQ_FORCEINLINE std::size_t span(checked<std::size_t> count, std::size_t elem_size = 1, std::size_t header = 0, std::size_t trailer = 0) const
+    {
+        const auto rem = _bound - _val;
+        const auto n = static_cast<std::size_t>(count);
+#ifdef MQ_HAS_BUILTIN_OVERFLOW
+        std::size_t bytes;
+        std::size_t total;
+        bool bad = __builtin_mul_overflow(n, elem_size, &bytes);
+        bad |= __builtin_add_overflow(bytes, header, &bytes);
+        bad |= __builtin_add_overflow(bytes, trailer, &total);
+        bad |= total > rem;
+        if (bad)
+        {
+            detail::throw_overrun();
+        }
+        return bytes;
+#else
+        if (header > rem || trailer > rem - header || (elem_size != 0 && n > (rem - header - trailer) / elem_size))
+        {
+            detail::throw_overrun();
+        }
+        return n * elem_size + header;
+#endif
+    }
+
+    MQ_FORCEINLINE checked_offset advance(checked<std::size_t> count, std::size_t elem_size = 1, std::size_t header = 0) const
+    {
+        return checked_offset{ _val + span(count, elem_size, header), _bound, unchecked_t{} };
+    }
+
+    checked<std::size_t> remaining() const noexcept
+    {
+        return _bound - _val;
+    }
+
+    checked<std::size_t> bound() const noexcept
+    {
+        return _bound;
+    }
+
+    operator checked<std::size_t>() const noexcept
+    {
+        return _val;
+    }
+};
+
+//a read cursor over the byte buffer `[first, last)` with element type `T`.
+//every access is validated against the end of the buffer, reads yield `checked<T>` directly
+//and do not require the buffer to be aligned for `T`
+template <class T>
+class checked_ptr
+{
+    static_assert(std::is_integral_v<T>, "checked_ptr requires an integral element type");
+
+    template <class U>
+    friend class checked_ptr;
+
+private:
+    const unsigned char* _base;
+    checked_offset _pos;
+
+public:
+    checked_ptr(const void* first, checked<std::size_t> size) noexcept
+        : _base(static_cast<const unsigned char*>(first)), _pos(size)
+    {
+    }
+
+    checked_ptr(const void* first, const void* last)
+        : checked_ptr(first, detail::byte_distance(first, last))
+    {
+    }
+
+    //reinterprets the same position with another element type
+    template <class U, std::enable_if_t<!std::is_same_v<T, U>, int> = 0>
+    explicit checked_ptr(const checked_ptr<U>& other) noexcept
+        : _base(other._base), _pos(other._pos)
+    {
+    }
+
+    const void* get() const noexcept
+    {
+        return _base + static_cast<std::size_t>(checked<std::size_t>{ _pos });
+    }
+
+    checked_offset offset() const noexcept
+    {
+        return _pos;
+    }
+
+    //number of whole elements left
+    checked<std::size_t> remaining() const noexcept
+    {
+        return static_cast<std::size_t>(_pos.remaining()) / sizeof(T);
+    }
+
+    //moves to the absolute byte offset `off` from the start of the buffer
+    checked_ptr& seek(checked<std::size_t> off)
+    {
+        _pos = checked_offset{ off, _pos.bound() };
+        return *this;
+    }
+
+    //reads the element `index` elements after a `header` of bytes, i.e. `base + header + index * sizeof(T)`
+    MQ_FORCEINLINE checked<T> at(checked<std::size_t> index, std::size_t header = 0) const
+    {
+        const auto p = static_cast<const unsigned char*>(get());
+        return detail::load<T>(p + _pos.span(index, sizeof(T), header, sizeof(T)));
+    }
+
+    MQ_FORCEINLINE checked<T> operator[](checked<std::size_t> index) const
+    {
+        return at(index);
+    }
+
+    MQ_FORCEINLINE checked<T> operator*() const
+    {
+        return at(std::size_t{ 0 });
+    }
+
+    MQ_FORCEINLINE checked_ptr& operator+=(checked<std::size_t> n)
+    {
+        _pos = _pos.advance(n, sizeof(T));
+        return *this;
+    }
+
+    checked_ptr operator+(checked<std::size_t> n) const
+    {
+        auto tmp = *this;
+        return tmp += n;
+    }
+
+    checked_ptr& operator++()
+    {
+        return *this += std::size_t{ 1 };
+    }
+
+    checked_ptr operator++(int)
+    {
+        auto tmp = *this;
+        ++(*this);
+        return tmp;
+    }
+
+    //reads the current element and advances past it
+    MQ_FORCEINLINE checked<T> read()
+    {
+        const auto p = static_cast<const unsigned char*>(get());
+        _pos = _pos.advance(std::size_t{ 1 }, sizeof(T));
+        return detail::load<T>(p);
+    }
+
+    //reads a packed sequence of fields and advances past them,
+    //the total span is known at compile time and validated once for all fields
+    template <class... Us>
+    std::tuple<checked<Us>...> read_fields()
+    {
+        static_assert(std::conjunction_v<std::is_integral<Us>...>, "fields must be integral");
+        auto p = static_cast<const unsigned char*>(get());
+        _pos = _pos.advance((sizeof(Us) + ... + 0));
+        return std::tuple<checked<Us>...>{ checked<Us>{ detail::load_advance<Us>(p) }... }; //braced init evaluates in order
+    }
+
+    //reads `count` elements into `out` and advances past them, validated once for the whole run
+    void read_n(checked<T>* out, checked<std::size_t> count)
+    {
+        const auto p = static_cast<const unsigned char*>(get());
+        _pos = _pos.advance(count, sizeof(T));
+        const auto n = static_cast<std::size_t>(count);
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            out[i] = checked<T>{ detail::load<T>(p + i * sizeof(T)) };
+        }
+    }
+};
+}
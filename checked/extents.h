@@ -0,0 +1,187 @@
+#pragma once
+
+#include "checked.h"
+#include <array>
+#include <cstddef>
+#include <utility>
+
+namespace mq
+{
+constexpr std::size_t dynamic_extent = std::numeric_limits<std::size_t>::max();
+
+namespace detail
+{
+[[noreturn]]
+MQ_COLD inline void throw_index_out_of_range()
+{
+    throw std::out_of_range{ "Index out of range." };
+}
+
+//usable in constant expressions, where reaching the throw fails compilation
+constexpr std::size_t extent_mul(std::size_t l, std::size_t r)
+{
+#ifdef MQ_HAS_BUILTIN_OVERFLOW
+    std::size_t result = 0;
+    if (__builtin_mul_overflow(l, r, &result))
+    {
+        throw_overflow();
+    }
+    return result;
+#else
+    if (r != 0 && std::numeric_limits<std::size_t>::max() / r < l)
+    {
+        throw_overflow();
+    }
+    return l * r;
+#endif
+}
+
+//negative values wrap around to huge ones and fail the bounds check
+template <class I>
+constexpr std::size_t to_index(I i) noexcept
+{
+    return static_cast<std::size_t>(i);
+}
+
+template <class I>
+constexpr std::size_t to_index(checked<I> i) noexcept
+{
+    return static_cast<std::size_t>(static_cast<I>(i));
+}
+}
+
+//a row-major shape mixing static and `dynamic_extent` extents, like `std::extents`.
+//the element count and every stride are validated once at construction (static parts at compile time),
+//so any in-bounds multi-index maps to a linear offset below `size()` that needs no overflow check
+template <std::size_t... Es>
+class checked_extents
+{
+private:
+    static constexpr std::array<std::size_t, sizeof...(Es)> _static = { Es... };
+    static constexpr std::size_t _rank_dynamic = (std::size_t{ 0 } + ... + (Es == dynamic_extent));
+
+    static constexpr std::size_t count_dynamic(std::size_t end) noexcept
+    {
+        std::size_t n = 0;
+        for (std::size_t r = 0; r < end; ++r)
+        {
+            n += _static[r] == dynamic_extent;
+        }
+        return n;
+    }
+
+    //product of all extents after `r`, or `dynamic_extent` if any of them is dynamic
+    static constexpr std::size_t static_stride(std::size_t r)
+    {
+        std::size_t stride = 1;
+        for (std::size_t i = sizeof...(Es); i-- > r + 1;)
+        {
+            if (_static[i] == dynamic_extent)
+            {
+                return dynamic_extent;
+            }
+            stride = detail::extent_mul(stride, _static[i]);
+        }
+        return stride;
+    }
+
+public:
+    static constexpr std::size_t rank() noexcept
+    {
+        return sizeof...(Es);
+    }
+
+    static constexpr std::size_t rank_dynamic() noexcept
+    {
+        return _rank_dynamic;
+    }
+
+    static constexpr std::size_t static_extent(std::size_t r) noexcept
+    {
+        return _static[r];
+    }
+
+private:
+    std::array<std::size_t, _rank_dynamic> _dyn{};
+    std::array<std::size_t, sizeof...(Es)> _strides{};
+    std::size_t _size = 1;
+
+    template <std::size_t R>
+    constexpr std::size_t stride_at() const noexcept
+    {
+        if constexpr (static_stride(R) != dynamic_extent)
+        {
+            return static_stride(R);
+        }
+        else
+        {
+            return _strides[R];
+        }
+    }
+
+    template <std::size_t... Rs, class... Is>
+    constexpr std::size_t linear(std::index_sequence<Rs...>, Is... is) const
+    {
+        const std::size_t idx[] = { detail::to_index(is)... };
+        if (!(true & ... & (idx[Rs] < extent(Rs))))
+        {
+            detail::throw_index_out_of_range();
+        }
+        return (std::size_t{ 0 } + ... + (idx[Rs] * stride_at<Rs>()));
+    }
+
+public:
+    //takes the dynamic extents in order, throws `std::overflow_error` if the element count does not fit `size_t`
+    template <class... Ds, std::enable_if_t<sizeof...(Ds) == _rank_dynamic, int> = 0>
+    constexpr explicit checked_extents(Ds... ds)
+        : _dyn{ static_cast<std::size_t>(checked<std::size_t>{ ds })... }
+    {
+        bool empty = false;
+        for (std::size_t r = 0; r < rank(); ++r)
+        {
+            empty |= extent(r) == 0;
+        }
+        if (empty)
+        { //no index is valid, strides are never used and may not even be representable
+            _size = 0;
+            return;
+        }
+        for (std::size_t r = rank(); r-- > 0;)
+        {
+            _strides[r] = _size;
+            _size = detail::extent_mul(_size, extent(r));
+        }
+    }
+
+    constexpr std::size_t extent(std::size_t r) const noexcept
+    {
+        return _static[r] != dynamic_extent ? _static[r] : _dyn[count_dynamic(r)];
+    }
+
+    constexpr std::size_t stride(std::size_t r) const noexcept
+    {
+        return _strides[r];
+    }
+
+    //total number of elements, every linear index is below it
+    constexpr checked<std::size_t> size() const noexcept
+    {
+        return _size;
+    }
+
+    //row-major linear offset of the multi-index `is`, throws `std::out_of_range` if any index is out of bounds.
+    //accepts plain or `checked` integers
+    template <class... Is, std::enable_if_t<sizeof...(Is) == sizeof...(Es), int> = 0>
+    constexpr checked<std::size_t> operator()(Is... is) const
+    {
+        if constexpr (sizeof...(Es) == 0)
+        {
+            return std::size_t{ 0 };
+        }
+        else
+        {
+            return linear(std::index_sequence_for<Is...>{}, is...);
+        }
+    }
+};
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "checked.h"
+#include <cstddef>
+#include <cstdint>
+
+#ifdef MQ_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace mq
+{
+namespace detail
+{
+#ifdef MQ_HAS_SSE2
+//range compare and truncating conversion of 4 floats (cvttps2dq) or 2 doubles (cvttpd2dq) at a time
+template <class F>
+std::size_t float_cast_sse2(const F* in, checked<std::int32_t>* out, std::size_t n) noexcept
+{
+    using range = float_range<std::int32_t, F>;
+    std::size_t i = 0;
+    if constexpr (std::is_same_v<F, float>)
+    {
+        const auto lo = _mm_set1_ps(range::lower);
+        const auto hi = _mm_set1_ps(range::upper);
+        for (; i + 4 <= n; i += 4)
+        {
+            const auto v = _mm_loadu_ps(in + i);
+            const auto lo_ok = range::lower_inclusive ? _mm_cmpge_ps(v, lo) : _mm_cmpgt_ps(v, lo);
+            if (_mm_movemask_ps(_mm_and_ps(lo_ok, _mm_cmplt_ps(v, hi))) != 0xf)
+            {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_cvttps_epi32(v));
+        }
+    }
+    else if constexpr (std::is_same_v<F, double>)
+    {
+        const auto lo = _mm_set1_pd(range::lower);
+        const auto hi = _mm_set1_pd(range::upper);
+        for (; i + 2 <= n; i += 2)
+        {
+            const auto v = _mm_loadu_pd(in + i);
+            const auto lo_ok = range::lower_inclusive ? _mm_cmpge_pd(v, lo) : _mm_cmpgt_pd(v, lo);
+            if (_mm_movemask_pd(_mm_and_pd(lo_ok, _mm_cmplt_pd(v, hi))) != 0x3)
+            {
+                break;
+            }
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm_cvttpd_epi32(v));
+        }
+    }
+    return i;
+}
+#endif
+
+template <class T, class F, float_round Mode>
+std::size_t float_cast_kernel(const F* in, checked<T>* out, std::size_t n) noexcept
+{
+    using range = float_range<T, F>;
+    constexpr std::size_t block = 16;
+    std::size_t i = 0;
+#ifdef MQ_HAS_SSE2
+    if constexpr (Mode == float_round::toward_zero && std::is_same_v<T, std::int32_t> &&
+        (std::is_same_v<F, float> || std::is_same_v<F, double>))
+    {
+        i = float_cast_sse2(in, out, n);
+    }
+#endif
+    //branch-free validation of a whole block, so that the compiler can vectorize both loops
+    for (; i + block <= n; i += block)
+    {
+        F tmp[block];
+        bool ok = true;
+        for (std::size_t j = 0; j < block; ++j)
+        {
+            tmp[j] = float_round_to(in[i + j], Mode);
+            ok &= range::contains(tmp[j]);
+        }
+        if (!ok)
+        {
+            break;
+        }
+        for (std::size_t j = 0; j < block; ++j)
+        {
+            out[i + j] = checked<T>{ static_cast<T>(tmp[j]) };
+        }
+    }
+    //the tail, or the block holding the first failure
+    for (; i < n; ++i)
+    {
+        const auto f = float_round_to(in[i], Mode);
+        if (!range::contains(f))
+        {
+            return i;
+        }
+        out[i] = checked<T>{ static_cast<T>(f) };
+    }
+    return n;
+}
+}
+
+//converts `[first, last)` into `out` with rounding `mode`, stopping at the first NaN, infinite or
+//out-of-range element instead of throwing. Returns its index (elements before it are written),
+//or `last - first` if all of them were converted
+template <class T, class F>
+std::size_t checked_cast_range(const F* first, const F* last, checked<T>* out, float_round mode = float_round::toward_zero) noexcept
+{
+    static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool> && std::is_floating_point_v<F>, "floating-point to integer conversion only");
+    const auto n = static_cast<std::size_t>(last - first);
+    switch (mode)
+    {
+    case float_round::nearest:
+        return detail::float_cast_kernel<T, F, float_round::nearest>(first, out, n);
+    case float_round::downward:
+        return detail::float_cast_kernel<T, F, float_round::downward>(first, out, n);
+    case float_round::upward:
+        return detail::float_cast_kernel<T, F, float_round::upward>(first, out, n);
+    default:
+        return detail::float_cast_kernel<T, F, float_round::toward_zero>(first, out, n);
+    }
+}
+}
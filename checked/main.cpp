@@ -1,5 +1,14 @@
 #include "checked.h"
+#include "checked_math.h"
+#include "checked_ptr.h"
+#include "extents.h"
+#include "float_cast.h"
+#include "narrow.h"
+#include "scan.h"
+#include "varint.h"
+#include <cassert>
 #include <chrono>
+#include <cmath>
 #include <iostream>
 #include <memory>
 using namespace mq;
@@ -9,6 +18,197 @@ void foo(int v)
 void bar(short d)
 {
 }
+
+void varint_demo()
+{
+    std::uint8_t buf[16] = {};
+    auto end = varint::encode(checked<std::uint32_t>{ 300u }, buf, buf + sizeof buf);
+    end = varint::encode_zigzag(checked<int>{ -2 }, end, buf + sizeof buf);
+    checked<std::uint32_t> u;
+    checked<int> s;
+    auto p = varint::decode(buf, end, u);
+    p = varint::decode_zigzag(p, end, s);
+    assert(p == end && u == 300u && s == -2);
+
+    const std::uint8_t padded[] = { 0x80, 0x00 };
+    const std::uint8_t big[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x01 }; //2^35
+    checked<std::uint32_t> out[2];
+    assert(varint::decode_bulk(padded, padded + 2, out, 2).ec == varint::errc::overlong);
+    assert(varint::decode_bulk(big, big + 6, out, 2).ec == varint::errc::overflow);
+    assert(varint::decode_bulk(big, big + 3, out, 2).ec == varint::errc::truncated);
+    try
+    {
+        varint::decode(big, big + 6, u);
+        assert(false);
+    }
+    catch (std::overflow_error&)
+    {
+    }
+}
+void checked_ptr_demo()
+{
+    const unsigned char buf[16] = { 1, 0, 0, 0, 2, 0, 0, 0, 3, 0, 0, 0, 4, 0, 0, 0 };
+    checked_ptr<std::uint32_t> p(buf, buf + sizeof buf);
+    assert(p.at(std::size_t{ 1 }, 4) == 3u);
+    try
+    {
+        p.at(std::size_t{ 3 }, 4); //the last 4 bytes would lie past the end
+        assert(false);
+    }
+    catch (std::out_of_range&)
+    {
+    }
+    try
+    {
+        checked_ptr<std::uint32_t> reversed(buf + 4, buf);
+        assert(false);
+    }
+    catch (std::out_of_range&)
+    {
+    }
+
+    const unsigned char packed[7] = { 1, 2, 0, 3, 0, 0, 0 };
+    checked_ptr<std::uint8_t> fields(packed, packed + sizeof packed);
+    auto [a, b, c] = fields.read_fields<std::uint8_t, std::uint16_t, std::uint32_t>(); //fields are loaded in order
+    assert(a == 1u && b == 2u && c == 3u);
+    assert(fields.remaining() == 0u);
+    checked_ptr<std::uint8_t> short_fields(packed, packed + sizeof packed - 1);
+    try
+    {
+        short_fields.read_fields<std::uint8_t, std::uint16_t, std::uint32_t>(); //one byte short
+        assert(false);
+    }
+    catch (std::out_of_range&)
+    {
+    }
+    assert(short_fields.remaining() == sizeof packed - 1); //nothing was consumed
+
+    checked<std::uint32_t> out[4];
+    try
+    {
+        p.read_n(out, std::numeric_limits<std::size_t>::max() / 4 + 1); //count * 4 wraps around to 4
+        assert(false);
+    }
+    catch (std::out_of_range&)
+    {
+    }
+    p.read_n(out, std::size_t{ 4 });
+    assert(out[0] == 1u && out[3] == 4u);
+}
+
+void float_cast_demo()
+{
+    assert(checked_cast<int>(2.5) == 2);
+    assert(checked_cast<int>(2.5, float_round::upward) == 3);
+    assert(checked_cast<short>(-32768.9f) == -32768);
+    try
+    {
+        checked_cast<short>(32768.0f);
+        assert(false);
+    }
+    catch (std::overflow_error&)
+    {
+    }
+    try
+    {
+        checked<int> nan{ std::nan("") };
+        assert(false);
+    }
+    catch (std::overflow_error&)
+    {
+    }
+
+    const double in[] = { 1.5, -7.0, 3e9, 4.0 };
+    checked<int> out[4];
+    assert(checked_cast_range(in, in + 4, out, float_round::nearest) == 2); //3e9 does not fit `int`
+    assert(out[0] == 2 && out[1] == -7);
+}
+
+void scan_demo()
+{
+    const checked<int> lengths[] = { 3, 4, std::numeric_limits<int>::max(), 5 };
+    checked<int> offsets[5];
+    assert(checked_exclusive_scan(lengths, lengths + 2, offsets) == 2);
+    assert(offsets[0] == 0 && offsets[1] == 3 && offsets[2] == 7); //n + 1 offsets, the last is the total
+    assert(checked_exclusive_scan(lengths + 1, lengths + 3, offsets, 10) == 1);
+    assert(offsets[0] == 10 && offsets[1] == 14); //the failing element's own offset still fits
+    assert(checked_inclusive_scan(lengths, lengths + 4, offsets) == 2); //3 + 4 + max overflows
+    assert(checked_inclusive_scan_parallel(lengths, lengths + 4, offsets, -12, 4) == 4);
+    assert(offsets[3] == std::numeric_limits<int>::max());
+    assert(checked_exclusive_scan_parallel(lengths, lengths + 2, offsets, 1, 2) == 2 && offsets[2] == 8);
+}
+
+void extents_demo()
+{
+    const checked_extents<dynamic_extent, 4, dynamic_extent> ext(2, 3);
+    assert(ext.size() == 24u && ext.stride(0) == 12u);
+    assert(ext(1, 3, 2) == 23u);
+    try
+    {
+        ext(0, 4, 0);
+        assert(false);
+    }
+    catch (std::out_of_range&)
+    {
+    }
+    try
+    {
+        ext(-1, 0, 0);
+        assert(false);
+    }
+    catch (std::out_of_range&)
+    {
+    }
+    try
+    {
+        checked_extents<dynamic_extent, dynamic_extent> huge(std::numeric_limits<std::size_t>::max(), 2);
+        assert(false);
+    }
+    catch (std::overflow_error&)
+    {
+    }
+}
+
+void math_demo()
+{
+    //3037000499 is the largest base whose square fits `int64_t`
+    assert(checked_pow(checked<std::int64_t>{ std::int64_t{ 3037000499 } }, 2) == std::int64_t{ 9223372030926249001 });
+    try
+    {
+        checked_pow(checked<std::int64_t>{ std::int64_t{ 3037000500 } }, 2);
+        assert(false);
+    }
+    catch (std::overflow_error&)
+    {
+    }
+    assert(checked_pow(checked<std::int64_t>{ std::int64_t{ -2 } }, 63) == std::numeric_limits<std::int64_t>::min());
+    assert(checked_pow(checked<int>{ 1 }, 1000) == 1 && checked_pow(checked<int>{ -1 }, 1001) == -1);
+    assert(checked_lcm(checked<int>{ 4 }, checked<int>{ 6 }) == 12 && checked_isqrt(checked<int>{ 99 }) == 9);
+    try
+    {
+        checked_abs(checked<int>{ std::numeric_limits<int>::min() });
+        assert(false);
+    }
+    catch (std::overflow_error&)
+    {
+    }
+}
+
+void narrow_demo()
+{
+    checked<std::int64_t> column[40];
+    for (int i = 0; i < 40; ++i)
+    {
+        column[i] = checked<std::int64_t>{ std::int64_t{ i } * 1000 - 20000 };
+    }
+    assert(min_fitting_type(column, column + 40) == integer_kind::int16);
+    checked<std::int16_t> narrow[40];
+    assert(checked_narrow(column, column + 40, narrow) == 40 && narrow[39] == 19000);
+    column[21] = checked<std::int64_t>{ std::int64_t{ 1 } << 32 };
+    assert(checked_narrow(column, column + 40, narrow) == 21);
+    assert(min_fitting_type(column, column + 40) == integer_kind::int64);
+}
+
 int main()
 {
     checked<int> a = 10;
@@ -108,6 +308,14 @@ int main()
     //cd1 += cd2;
     //
     //auto cd3 = cd1 + cd2;
-    
+
+    varint_demo();
+    checked_ptr_demo();
+    float_cast_demo();
+    scan_demo();
+    extents_demo();
+    math_demo();
+    narrow_demo();
+
     std::cout << std::endl;
 }
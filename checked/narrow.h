@@ -0,0 +1,263 @@
+#pragma once
+
+#include "checked.h"
+#include <cstddef>
+#include <cstdint>
+
+#ifdef MQ_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace mq
+{
+//the integer type a column can be narrowed to, see `min_fitting_type`
+enum class integer_kind
+{
+    int8,
+    uint8,
+    int16,
+    uint16,
+    int32,
+    uint32,
+    int64,
+    uint64,
+};
+
+namespace detail
+{
+//the values of `From` that convert to `To` without overflow are exactly `[lo, hi]`
+template <class To, class From>
+struct narrow_range
+{
+    static_assert(std::is_integral_v<To> && std::is_integral_v<From> && !std::is_same_v<To, bool> && !std::is_same_v<From, bool>,
+        "narrowing requires non-bool integral types");
+
+    static constexpr From lo = std::is_signed_v<From> && std::is_signed_v<To> && sizeof(To) < sizeof(From)
+        ? static_cast<From>(std::numeric_limits<To>::min())
+        : std::is_signed_v<From> && std::is_unsigned_v<To> ? From{ 0 } : std::numeric_limits<From>::min();
+    static constexpr From hi = static_cast<std::uintmax_t>(std::numeric_limits<To>::max()) < static_cast<std::uintmax_t>(std::numeric_limits<From>::max())
+        ? static_cast<From>(std::numeric_limits<To>::max())
+        : std::numeric_limits<From>::max();
+    static constexpr bool always = lo == std::numeric_limits<From>::min() && hi == std::numeric_limits<From>::max();
+};
+
+#ifdef MQ_HAS_SSE2
+//packs the lanes of `a` and `b` into one vector of the half as wide `Dst`, clearing `ok` unless all of them are in range.
+//a lane is in range exactly when it survives the saturating pack round trip unchanged. SSE2 has no 64 bit
+//compare or pack, so there the high dword is checked against the sign extension of the low one instead
+template <class Src, class Dst>
+MQ_FORCEINLINE __m128i narrow_step(__m128i a, __m128i b, bool& ok) noexcept
+{
+    static_assert(sizeof(Src) == 2 * sizeof(Dst), "one step halves the lane width");
+    //an unsigned source lane with its sign bit set would look negative to the signed instructions
+    constexpr bool check_sign = std::is_unsigned_v<Src> && std::is_signed_v<Dst>;
+    const auto zero = _mm_setzero_si128();
+    if constexpr (sizeof(Src) == 8)
+    {
+        const auto fits = [&](__m128i v)
+        {
+            const auto sign = _mm_shuffle_epi32(_mm_srai_epi32(v, 31), _MM_SHUFFLE(2, 2, 0, 0));
+            if constexpr (std::is_unsigned_v<Dst>)
+            {
+                return _mm_cmpeq_epi32(v, zero);
+            }
+            else if constexpr (check_sign)
+            {
+                return _mm_and_si128(_mm_cmpeq_epi32(v, zero), _mm_cmpeq_epi32(sign, zero));
+            }
+            else
+            {
+                return _mm_cmpeq_epi32(v, sign);
+            }
+        };
+        ok &= (_mm_movemask_epi8(_mm_and_si128(fits(a), fits(b))) & 0xf0f0) == 0xf0f0;
+        return _mm_unpacklo_epi64(_mm_shuffle_epi32(a, _MM_SHUFFLE(3, 1, 2, 0)), _mm_shuffle_epi32(b, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    else if constexpr (sizeof(Src) == 4)
+    {
+        //SSE2 has no unsigned 32 bit pack, `[0, 65535]` is moved onto the signed range and back
+        const auto bias = std::is_unsigned_v<Dst> ? _mm_set1_epi32(0x8000) : zero;
+        a = _mm_sub_epi32(a, bias);
+        b = _mm_sub_epi32(b, bias);
+        const auto p = _mm_packs_epi32(a, b);
+        const auto ra = _mm_srai_epi32(_mm_unpacklo_epi16(p, p), 16);
+        const auto rb = _mm_srai_epi32(_mm_unpackhi_epi16(p, p), 16);
+        ok &= _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi32(a, ra), _mm_cmpeq_epi32(b, rb))) == 0xffff;
+        if constexpr (check_sign)
+        {
+            ok &= (_mm_movemask_epi8(_mm_or_si128(a, b)) & 0x8888) == 0;
+        }
+        return std::is_unsigned_v<Dst> ? _mm_xor_si128(p, _mm_set1_epi16(-0x8000)) : p;
+    }
+    else
+    {
+        __m128i p;
+        __m128i ra;
+        __m128i rb;
+        if constexpr (std::is_signed_v<Dst>)
+        {
+            p = _mm_packs_epi16(a, b);
+            ra = _mm_srai_epi16(_mm_unpacklo_epi8(p, p), 8);
+            rb = _mm_srai_epi16(_mm_unpackhi_epi8(p, p), 8);
+        }
+        else
+        {
+            p = _mm_packus_epi16(a, b);
+            ra = _mm_unpacklo_epi8(p, zero);
+            rb = _mm_unpackhi_epi8(p, zero);
+        }
+        ok &= _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(a, ra), _mm_cmpeq_epi16(b, rb))) == 0xffff;
+        if constexpr (check_sign)
+        {
+            ok &= (_mm_movemask_epi8(_mm_or_si128(a, b)) & 0xaaaa) == 0;
+        }
+        return p;
+    }
+}
+
+//narrows the next `16 / sizeof(To)` elements into one vector. wider gaps are bridged by halving steps through
+//signed intermediates, which hold every value of `To` and so do not change which lanes are in range
+template <class To, class From>
+MQ_FORCEINLINE __m128i narrow_vector(const checked<From>* in, bool& ok) noexcept
+{
+    if constexpr (sizeof(From) == 2 * sizeof(To))
+    {
+        const auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+        const auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 16 / sizeof(From)));
+        return narrow_step<From, To>(a, b, ok);
+    }
+    else
+    {
+        using mid = std::conditional_t<sizeof(To) == 1, std::int16_t, std::int32_t>;
+        const auto a = narrow_vector<mid>(in, ok);
+        const auto b = narrow_vector<mid>(in + 16 / sizeof(mid), ok);
+        return narrow_step<mid, To>(a, b, ok);
+    }
+}
+
+//every pair with a narrower `To`. sign changes at the same width are left to the min/max blocks
+template <class To, class From>
+std::size_t narrow_sse2(const checked<From>* in, checked<To>* out, std::size_t n) noexcept
+{
+    std::size_t i = 0;
+    if constexpr (sizeof(To) < sizeof(From))
+    {
+        constexpr std::size_t lanes = 16 / sizeof(To);
+        for (; i + lanes <= n; i += lanes)
+        {
+            bool ok = true;
+            const auto v = narrow_vector<To>(in + i, ok);
+            if (!ok)
+            {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), v);
+        }
+    }
+    return i;
+}
+#endif
+
+template <class From>
+struct min_max
+{
+    From min;
+    From max;
+};
+
+//branch-free so that the compiler turns it into vector min/max
+template <class From>
+min_max<From> reduce_min_max(const checked<From>* in, std::size_t n) noexcept
+{
+    auto mn = std::numeric_limits<From>::max();
+    auto mx = std::numeric_limits<From>::min();
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const auto v = static_cast<From>(in[i]);
+        mn = v < mn ? v : mn;
+        mx = v > mx ? v : mx;
+    }
+    return { mn, mx };
+}
+
+template <class To, class From>
+constexpr bool fits(min_max<From> r) noexcept
+{
+    return r.min >= narrow_range<To, From>::lo && r.max <= narrow_range<To, From>::hi;
+}
+
+//the kind of the signed `S` or unsigned `U` holding all of `r`, if either does
+template <class S, class U, class From>
+bool fitting_kind(min_max<From> r, integer_kind sk, integer_kind uk, integer_kind& kind) noexcept
+{
+    const bool s = fits<S>(r);
+    const bool u = fits<U>(r);
+    if (!s && !u)
+    {
+        return false;
+    }
+    kind = s && (std::is_signed_v<From> || !u) ? sk : uk;
+    return true;
+}
+}
+
+//converts `[first, last)` into `out`, stopping at the first value that does not fit `To` instead of throwing.
+//returns its index (elements before it are written), or `last - first` if all of them were converted.
+//whole blocks are validated at once with a min/max reduction before they are narrowed
+template <class To, class From>
+std::size_t checked_narrow(const checked<From>* first, const checked<From>* last, checked<To>* out) noexcept
+{
+    using range = detail::narrow_range<To, From>;
+    constexpr std::size_t block = 64;
+    const auto n = static_cast<std::size_t>(last - first);
+    std::size_t i = 0;
+    if constexpr (range::always)
+    {
+        for (; i < n; ++i)
+        {
+            out[i] = checked<To>{ static_cast<To>(static_cast<From>(first[i])) };
+        }
+        return n;
+    }
+#ifdef MQ_HAS_SSE2
+    i = detail::narrow_sse2(first, out, n);
+#endif
+    for (; i + block <= n; i += block)
+    {
+        if (!detail::fits<To>(detail::reduce_min_max(first + i, block)))
+        {
+            break;
+        }
+        for (std::size_t j = 0; j < block; ++j)
+        {
+            out[i + j] = checked<To>{ static_cast<To>(static_cast<From>(first[i + j])) };
+        }
+    }
+    for (; i < n; ++i)
+    {
+        const auto v = static_cast<From>(first[i]);
+        if (v < range::lo || v > range::hi)
+        {
+            return i;
+        }
+        out[i] = checked<To>{ static_cast<To>(v) };
+    }
+    return n;
+}
+
+//the smallest integer type holding every value of `[first, last)`. between a signed and an unsigned type
+//of the same size, the one with the signedness of `From` is preferred
+template <class From>
+integer_kind min_fitting_type(const checked<From>* first, const checked<From>* last) noexcept
+{
+    const auto r = detail::reduce_min_max(first, static_cast<std::size_t>(last - first));
+    integer_kind kind{};
+    if (detail::fitting_kind<std::int8_t, std::uint8_t>(r, integer_kind::int8, integer_kind::uint8, kind) ||
+        detail::fitting_kind<std::int16_t, std::uint16_t>(r, integer_kind::int16, integer_kind::uint16, kind) ||
+        detail::fitting_kind<std::int32_t, std::uint32_t>(r, integer_kind::int32, integer_kind::uint32, kind))
+    {
+        return kind;
+    }
+    return std::is_signed_v<From> ? integer_kind::int64 : integer_kind::uint64;
+}
+}
@@ -0,0 +1,280 @@
+#pragma once
+
+#include "checked.h"
+#include <algorithm>
+#include <cstddef>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#ifdef MQ_HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace mq
+{
+namespace detail
+{
+//keeps a parameter out of template argument deduction, so that plain integers convert to it
+template <class T>
+struct identity
+{
+    using type = T;
+};
+
+template <class T>
+using identity_t = typename identity<T>::type;
+
+//the prefixes are computed with wrapping arithmetic in the unsigned type. as long as no earlier step
+//overflowed, `prev` is exact, so the overflow of `prev + x` can be read off `prev`, `x` and the wrapped
+//`p` alone: the sign rule for signed types, the carry out for unsigned ones. the flag is the most significant bit
+template <class T, class U>
+MQ_FORCEINLINE U scan_overflow_bit(U prev, U x, U p) noexcept
+{
+    if constexpr (std::is_signed_v<T>)
+    {
+        return static_cast<U>((prev ^ p) & (x ^ p));
+    }
+    else
+    {
+        return static_cast<U>((prev & x) | ((prev | x) & ~p));
+    }
+}
+
+template <class T, bool Exclusive>
+std::size_t scan_serial(const checked<T>* in, checked<T>* out, std::size_t n, std::make_unsigned_t<T>& carry) noexcept
+{
+    using U = std::make_unsigned_t<T>;
+    constexpr auto msb = std::numeric_limits<U>::digits - 1;
+    constexpr std::size_t block = 64;
+    std::size_t i = 0;
+    //one overflow check per block, the exact position is only searched for once a block fails
+    for (; i + block <= n; i += block)
+    {
+        auto acc = carry;
+        U flags = 0;
+        for (std::size_t j = 0; j < block; ++j)
+        {
+            const auto x = static_cast<U>(static_cast<T>(in[i + j]));
+            const auto p = static_cast<U>(acc + x);
+            flags |= scan_overflow_bit<T>(acc, x, p);
+            out[i + j] = checked<T>{ static_cast<T>(Exclusive ? acc : p) };
+            acc = p;
+        }
+        if (flags >> msb)
+        {
+            break;
+        }
+        carry = acc;
+    }
+    for (; i < n; ++i)
+    {
+        const auto x = static_cast<U>(static_cast<T>(in[i]));
+        const auto p = static_cast<U>(carry + x);
+        if (scan_overflow_bit<T>(carry, x, p) >> msb)
+        {
+            return i;
+        }
+        out[i] = checked<T>{ static_cast<T>(Exclusive ? carry : p) };
+        carry = p;
+    }
+    return n;
+}
+
+#ifdef MQ_HAS_SSE2
+//in-register scan of 4 x 32 or 2 x 64 bit lanes. stops before the first group that overflows
+//and leaves it to `scan_serial` to find the exact index
+template <class T, bool Exclusive>
+std::size_t scan_sse2(const checked<T>* in, checked<T>* out, std::size_t n, std::make_unsigned_t<T>& carry) noexcept
+{
+    using U = std::make_unsigned_t<T>;
+    constexpr std::size_t lanes = 16 / sizeof(T);
+    std::size_t i = 0;
+    if constexpr (sizeof(T) == 4)
+    {
+        auto prefix = _mm_set1_epi32(static_cast<int>(carry));
+        for (; i + lanes <= n; i += lanes)
+        {
+            const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            auto s = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+            s = _mm_add_epi32(s, _mm_slli_si128(s, 8));
+            const auto p = _mm_add_epi32(s, prefix);
+            const auto prev = _mm_sub_epi32(p, x);
+            const auto flags = std::is_signed_v<T>
+                ? _mm_and_si128(_mm_xor_si128(prev, p), _mm_xor_si128(x, p))
+                : _mm_or_si128(_mm_and_si128(prev, x), _mm_andnot_si128(p, _mm_or_si128(prev, x)));
+            if (_mm_movemask_ps(_mm_castsi128_ps(flags)) != 0)
+            {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Exclusive ? prev : p);
+            prefix = _mm_shuffle_epi32(p, 0xff);
+        }
+        carry = static_cast<U>(_mm_cvtsi128_si32(prefix));
+    }
+    else if constexpr (sizeof(T) == 8)
+    {
+        auto prefix = _mm_set1_epi64x(static_cast<long long>(carry));
+        for (; i + lanes <= n; i += lanes)
+        {
+            const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            const auto p = _mm_add_epi64(_mm_add_epi64(x, _mm_slli_si128(x, 8)), prefix);
+            const auto prev = _mm_sub_epi64(p, x);
+            const auto flags = std::is_signed_v<T>
+                ? _mm_and_si128(_mm_xor_si128(prev, p), _mm_xor_si128(x, p))
+                : _mm_or_si128(_mm_and_si128(prev, x), _mm_andnot_si128(p, _mm_or_si128(prev, x)));
+            if (_mm_movemask_pd(_mm_castsi128_pd(flags)) != 0)
+            {
+                break;
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), Exclusive ? prev : p);
+            prefix = _mm_shuffle_epi32(p, 0xee);
+        }
+        U c;
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(&c), prefix);
+        carry = c;
+    }
+    return i;
+}
+#endif
+
+//on return `carry` is the prefix before the returned index, i.e. the total if nothing overflowed
+template <class T, bool Exclusive>
+std::size_t checked_scan(const checked<T>* in, checked<T>* out, std::size_t n, std::make_unsigned_t<T>& carry) noexcept
+{
+    std::size_t i = 0;
+#ifdef MQ_HAS_SSE2
+    if constexpr (sizeof(T) == 4 || sizeof(T) == 8)
+    {
+        i = scan_sse2<T, Exclusive>(in, out, n, carry);
+    }
+#endif
+    return i + scan_serial<T, Exclusive>(in + i, out + i, n - i, carry);
+}
+
+template <class T>
+std::make_unsigned_t<T> wrapping_sum(const checked<T>* in, std::size_t n) noexcept
+{
+    using U = std::make_unsigned_t<T>;
+    U sum = 0;
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        sum = static_cast<U>(sum + static_cast<U>(static_cast<T>(in[i])));
+    }
+    return sum;
+}
+
+//two passes over `threads` chunks: the wrapped chunk sums give every chunk its starting prefix, then
+//the chunks are scanned independently. a chunk's starting prefix is only exact if no earlier chunk
+//overflowed, which is fine, since only the first overflowing chunk is reported. `carry` is as for `checked_scan`
+template <class T, bool Exclusive>
+std::size_t checked_scan_parallel(const checked<T>* in, checked<T>* out, std::size_t n, std::make_unsigned_t<T>& carry, unsigned threads)
+{
+    using U = std::make_unsigned_t<T>;
+    constexpr std::size_t min_chunk = 1 << 16;
+    threads = static_cast<unsigned>(std::min<std::size_t>(threads, n / min_chunk));
+    if (threads < 2)
+    {
+        return checked_scan<T, Exclusive>(in, out, n, carry);
+    }
+    const std::size_t chunk = (n + threads - 1) / threads;
+    const std::size_t chunks = (n + chunk - 1) / chunk;
+    const auto length = [&](std::size_t k) { return std::min(chunk, n - k * chunk); };
+    const auto run = [&](auto&& f)
+    {
+        std::vector<std::thread> workers;
+        workers.reserve(chunks - 1);
+        std::size_t k = 1;
+        try
+        {
+            for (; k < chunks; ++k)
+            {
+                workers.emplace_back(f, k);
+            }
+        }
+        catch (std::system_error&)
+        { //out of threads, the chunks left over run here
+        }
+        for (; k < chunks; ++k)
+        {
+            f(k);
+        }
+        f(0);
+        for (auto& w : workers)
+        {
+            w.join();
+        }
+    };
+
+    std::vector<U> prefix(chunks);
+    run([&](std::size_t k) { prefix[k] = k + 1 < chunks ? wrapping_sum(in + k * chunk, length(k)) : U{ 0 }; });
+    auto acc = carry;
+    for (auto& p : prefix)
+    {
+        const auto sum = p;
+        p = acc;
+        acc = static_cast<U>(acc + sum);
+    }
+
+    std::vector<std::size_t> result(chunks);
+    run([&](std::size_t k) { result[k] = k * chunk + checked_scan<T, Exclusive>(in + k * chunk, out + k * chunk, length(k), prefix[k]); });
+    for (std::size_t k = 0; k < chunks; ++k)
+    {
+        if (result[k] != k * chunk + length(k) || k + 1 == chunks)
+        {
+            carry = prefix[k];
+            return result[k];
+        }
+    }
+    return n; //unreachable, the last chunk always returns
+}
+
+template <class T, bool Exclusive, bool Parallel>
+std::size_t checked_scan_entry(const checked<T>* first, const checked<T>* last, checked<T>* out, checked<T> init, unsigned threads)
+{
+    static_assert(!std::is_same_v<T, bool>, "cannot scan bool");
+    const auto n = static_cast<std::size_t>(last - first);
+    auto carry = static_cast<std::make_unsigned_t<T>>(static_cast<T>(init));
+    const auto i = Parallel ? checked_scan_parallel<T, Exclusive>(first, out, n, carry, threads) : checked_scan<T, Exclusive>(first, out, n, carry);
+    if constexpr (Exclusive)
+    {
+        out[i] = checked<T>{ static_cast<T>(carry) };
+    }
+    return i;
+}
+}
+
+//`out[i] = init + first[0] + ... + first[i]`, computed with one overflow check per block of elements.
+//returns the index of the first element whose addition overflows, or `last - first` if none does.
+//`out` is only meaningful before the returned index
+template <class T>
+std::size_t checked_inclusive_scan(const checked<T>* first, const checked<T>* last, checked<T>* out, detail::identity_t<checked<T>> init = T{}) noexcept
+{
+    return detail::checked_scan_entry<T, false, false>(first, last, out, init, 1);
+}
+
+//`out[i] = init + first[0] + ... + first[i - 1]`, e.g. the offsets of an array of lengths.
+//`out` holds `last - first + 1` elements: returns the index `i` of the first element whose addition overflows,
+//or `last - first` if none does, and `out[0]` to `out[i]` are written either way. `out[i]` is the offset of
+//the failing element, or the total, which makes the offsets complete (Arrow-style `n + 1` offsets)
+template <class T>
+std::size_t checked_exclusive_scan(const checked<T>* first, const checked<T>* last, checked<T>* out, detail::identity_t<checked<T>> init = T{}) noexcept
+{
+    return detail::checked_scan_entry<T, true, false>(first, last, out, init, 1);
+}
+
+//multi-threaded versions of the above, for large inputs
+template <class T>
+std::size_t checked_inclusive_scan_parallel(const checked<T>* first, const checked<T>* last, checked<T>* out, detail::identity_t<checked<T>> init = T{},
+    unsigned threads = std::thread::hardware_concurrency())
+{
+    return detail::checked_scan_entry<T, false, true>(first, last, out, init, threads);
+}
+
+template <class T>
+std::size_t checked_exclusive_scan_parallel(const checked<T>* first, const checked<T>* last, checked<T>* out, detail::identity_t<checked<T>> init = T{},
+    unsigned threads = std::thread::hardware_concurrency())
+{
+    return detail::checked_scan_entry<T, true, true>(first, last, out, init, threads);
+}
+}
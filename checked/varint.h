@@ -0,0 +1,337 @@
+#pragma once
+
+#include "checked.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifdef MQ_HAS_SSE2
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace mq
+{
+namespace varint
+{
+enum class errc
+{
+    ok,
+    truncated, // input ends in the middle of a varint
+    overlong,  // zero padding, or longer than the encoding of any 64 bit value
+    overflow,  // well-formed, but the value does not fit the target type
+};
+
+struct decode_result
+{
+    const std::uint8_t* ptr; // one past the last decoded varint, or the first byte of the bad one
+    std::size_t count;       // number of values written
+    errc ec;
+};
+
+namespace detail
+{
+//length of the longest well-formed varint, a 64 bit value
+constexpr std::size_t wire_length = 10;
+
+template <class T>
+struct traits
+{
+    static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool>, "varint requires a non-bool integral type");
+
+    using unsigned_type = std::make_unsigned_t<T>;
+    using wide_type = std::conditional_t<(sizeof(T) > sizeof(std::uint32_t)), std::uint64_t, std::uint32_t>;
+
+    static constexpr int digits = std::numeric_limits<T>::digits;
+    static constexpr std::size_t max_length = (digits + 6) / 7;
+    //the last byte of a `max_length` encoding may only carry this many payload bits,
+    //anything above them is an out-of-range value
+    static constexpr int last_bits = digits - 7 * static_cast<int>(max_length - 1);
+};
+
+template <class U>
+constexpr std::make_signed_t<U> unzigzag(U u) noexcept
+{
+    return static_cast<std::make_signed_t<U>>((u >> 1) ^ (~(u & 1) + 1));
+}
+
+template <class T>
+constexpr std::make_unsigned_t<T> zigzag(T t) noexcept
+{
+    using U = std::make_unsigned_t<T>;
+    return static_cast<U>((static_cast<U>(t) << 1) ^ static_cast<U>(t < 0 ? ~U{0} : U{0}));
+}
+
+inline unsigned count_trailing_zeros(unsigned x) noexcept
+{
+#ifdef _MSC_VER
+    unsigned long idx;
+    _BitScanForward(&idx, x);
+    return static_cast<unsigned>(idx);
+#else
+    return static_cast<unsigned>(__builtin_ctz(x));
+#endif
+}
+
+//decodes a single varint whose value must fit `T`, advances `p` only on success.
+//encodings longer than `T` needs are read on up to `wire_length`, so that a too large value
+//is reported as `overflow` and only malformed input as `overlong`
+template <class T>
+errc decode_one(const std::uint8_t*& p, const std::uint8_t* last, T& out) noexcept
+{
+    using tr = traits<T>;
+    using wide = typename tr::wide_type;
+    wide v = 0;
+    for (std::size_t i = 0; i < wire_length; ++i)
+    {
+        if (p + i == last)
+        {
+            return errc::truncated;
+        }
+        const auto b = p[i];
+        if (b & 0x80)
+        {
+            if (i < tr::max_length)
+            {
+                v |= static_cast<wide>(b & 0x7f) << (7 * i);
+            }
+            continue;
+        }
+        if (i != 0 && b == 0)
+        {
+            return errc::overlong;
+        }
+        if (i >= tr::max_length || (i == tr::max_length - 1 && (b >> tr::last_bits)))
+        {
+            return errc::overflow;
+        }
+        v |= static_cast<wide>(b) << (7 * i);
+        p += i + 1;
+        out = static_cast<T>(v);
+        return errc::ok;
+    }
+    return errc::overlong;
+}
+
+template <class T>
+std::uint8_t* encode_raw(T v, std::uint8_t* first, std::uint8_t* last)
+{
+    using U = std::make_unsigned_t<T>;
+    auto u = static_cast<U>(v);
+    if (static_cast<std::size_t>(last - first) < traits<U>::max_length)
+    { //slow path, buffer may be too small
+        do
+        {
+            if (first == last)
+            {
+                throw std::out_of_range{ "Varint buffer too small." };
+            }
+            *first++ = static_cast<std::uint8_t>((u & 0x7f) | (u > 0x7f ? 0x80 : 0));
+            u = static_cast<U>(u >> 7);
+        } while (u != 0);
+        return first;
+    }
+    while (u > 0x7f)
+    {
+        *first++ = static_cast<std::uint8_t>(u | 0x80);
+        u = static_cast<U>(u >> 7);
+    }
+    *first++ = static_cast<std::uint8_t>(u);
+    return first;
+}
+
+[[noreturn]]
+inline void raise(errc ec)
+{
+    if (ec == errc::truncated)
+    {
+        throw std::out_of_range{ "Truncated varint." };
+    }
+    throw std::overflow_error{ ec == errc::overlong ? "Overlong varint." : "Varint overflow." };
+}
+
+#ifdef MQ_HAS_SSE2
+//the payload of a varint of `len` (1 to 8) bytes at `p`, from one little-endian 8 byte load and
+//a fixed sequence of shifts instead of a loop over the bytes. at least 8 bytes must be readable
+MQ_FORCEINLINE std::uint64_t gather7(const std::uint8_t* p, std::size_t len) noexcept
+{
+    std::uint64_t x;
+    std::memcpy(&x, p, sizeof x);
+    x &= ~std::uint64_t{ 0 } >> (64 - 8 * len);
+    return (x & 0x7f) | ((x >> 1) & 0x3f80) | ((x >> 2) & 0x1fc000) | ((x >> 3) & 0xfe00000) |
+        ((x >> 4) & 0x7f0000000) | ((x >> 5) & 0x3f800000000) | ((x >> 6) & 0x1fc0000000000) | ((x >> 7) & 0xfe000000000000);
+}
+#endif
+
+//`Zigzag` selects the signed zigzag mapping, the wire value is then decoded as the unsigned type of `T`
+template <class T, bool Zigzag>
+decode_result decode_bulk(const std::uint8_t* first, const std::uint8_t* last, checked<T>* out, std::size_t n) noexcept
+{
+    using R = std::conditional_t<Zigzag, std::make_unsigned_t<T>, T>;
+
+    const auto finish = [](R r) noexcept -> T
+    {
+        if constexpr (Zigzag)
+        {
+            return unzigzag(r);
+        }
+        else
+        {
+            return r;
+        }
+    };
+
+    std::size_t count = 0;
+    auto p = first;
+#ifdef MQ_HAS_SSE2
+    //the high bit of every byte is the continuation flag, so one movemask gives the end position of
+    //every varint inside a 16 byte window. the values are then assembled without per-byte branches
+    using tr = traits<R>;
+    using wide = typename tr::wide_type;
+    while (count < n && last - p >= 16)
+    {
+        const auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        auto ends = ~static_cast<unsigned>(_mm_movemask_epi8(chunk)) & 0xffffu;
+        if (ends == 0xffffu && n - count >= 16)
+        { //16 single-byte varints, always in range
+            for (std::size_t i = 0; i < 16; ++i)
+            {
+                out[count + i] = checked<T>{ finish(static_cast<R>(p[i])) };
+            }
+            count += 16;
+            p += 16;
+            continue;
+        }
+        if (ends == 0)
+        { //no terminator in 16 bytes, longer than `wire_length`
+            return { p, count, errc::overlong };
+        }
+        auto start = p;
+        while (ends != 0 && count < n)
+        {
+            const auto end = p + count_trailing_zeros(ends) + 1;
+            const auto len = static_cast<std::size_t>(end - start);
+            //combined without short-circuiting, the lengths are data dependent and would mispredict
+            const auto tail = end[-1];
+            const bool overlong = (len > wire_length) | ((len > 1) & (tail == 0));
+            if (overlong | (len > tr::max_length) | ((len == tr::max_length) & ((tail >> tr::last_bits) != 0)))
+            {
+                return { start, count, overlong ? errc::overlong : errc::overflow };
+            }
+            wide v;
+            if (last - start >= 8)
+            {
+                v = static_cast<wide>(gather7(start, tr::max_length > 8 && len > 8 ? 8 : len));
+                if constexpr (tr::max_length > 8)
+                {
+                    for (std::size_t i = 8; i < len; ++i)
+                    {
+                        v |= static_cast<wide>(start[i] & 0x7f) << (7 * i);
+                    }
+                }
+            }
+            else
+            { //too close to the end of the input for the 8 byte load
+                v = 0;
+                for (std::size_t i = 0; i < len; ++i)
+                {
+                    v |= static_cast<wide>(start[i] & 0x7f) << (7 * i);
+                }
+            }
+            out[count++] = checked<T>{ finish(static_cast<R>(v)) };
+            start = end;
+            ends &= ends - 1;
+        }
+        p = start;
+    }
+#endif
+    while (count < n && p != last)
+    {
+        R r;
+        const auto ec = decode_one(p, last, r);
+        if (ec != errc::ok)
+        {
+            return { p, count, ec };
+        }
+        out[count++] = checked<T>{ finish(r) };
+    }
+    return { p, count, errc::ok };
+}
+}
+
+//maximum encoded length of any value of `T`
+template <class T>
+constexpr std::size_t max_length_v = detail::traits<std::make_unsigned_t<T>>::max_length;
+
+//decodes one LEB128 varint into `out`, the value must fit `T` (negative values are never produced,
+//use `decode_zigzag` for signed data). Returns the position after the varint.
+//throws `std::overflow_error` for overlong or out-of-range encodings, `std::out_of_range` for truncated input
+template <class T>
+const std::uint8_t* decode(const std::uint8_t* first, const std::uint8_t* last, checked<T>& out)
+{
+    T t;
+    const auto ec = detail::decode_one(first, last, t);
+    if (ec != errc::ok)
+    {
+        detail::raise(ec);
+    }
+    out = checked<T>{ t };
+    return first;
+}
+
+template <class T>
+const std::uint8_t* decode_zigzag(const std::uint8_t* first, const std::uint8_t* last, checked<T>& out)
+{
+    static_assert(std::is_signed_v<T>, "zigzag requires a signed type");
+    std::make_unsigned_t<T> u;
+    const auto ec = detail::decode_one(first, last, u);
+    if (ec != errc::ok)
+    {
+        detail::raise(ec);
+    }
+    out = checked<T>{ detail::unzigzag(u) };
+    return first;
+}
+
+//encodes `v` into `[first, last)`, returns the position after the varint.
+//throws `std::overflow_error` for negative values, `std::out_of_range` if the buffer is too small
+template <class T>
+std::uint8_t* encode(checked<T> v, std::uint8_t* first, std::uint8_t* last)
+{
+    const auto t = static_cast<T>(v);
+    if constexpr (std::is_signed_v<T>)
+    {
+        if (t < 0)
+        {
+            detail::raise(errc::overflow);
+        }
+    }
+    return detail::encode_raw(t, first, last);
+}
+
+template <class T>
+std::uint8_t* encode_zigzag(checked<T> v, std::uint8_t* first, std::uint8_t* last)
+{
+    static_assert(std::is_signed_v<T>, "zigzag requires a signed type");
+    return detail::encode_raw(detail::zigzag(static_cast<T>(v)), first, last);
+}
+
+//decodes up to `n` consecutive varints into `out`, stops at the first malformed or
+//out-of-range one and reports its position instead of throwing.
+//input ending exactly on a varint boundary is not an error
+template <class T>
+decode_result decode_bulk(const std::uint8_t* first, const std::uint8_t* last, checked<T>* out, std::size_t n) noexcept
+{
+    return detail::decode_bulk<T, false>(first, last, out, n);
+}
+
+template <class T>
+decode_result decode_bulk_zigzag(const std::uint8_t* first, const std::uint8_t* last, checked<T>* out, std::size_t n) noexcept
+{
+    static_assert(std::is_signed_v<T>, "zigzag requires a signed type");
+    return detail::decode_bulk<T, true>(first, last, out, n);
+}
+}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+//best of `reps` runs of `f`, printed per item. `f` returns a result so that its work is not optimized away
+template <class F>
+auto bench(const char* name, std::size_t items, F&& f)
+{
+    constexpr int reps = 10;
+    auto best = std::chrono::steady_clock::duration::max();
+    decltype(f()) sum{};
+    for (int r = 0; r < reps; ++r)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        sum = f();
+        best = std::min(best, std::chrono::steady_clock::now() - start);
+    }
+    const auto ns = std::chrono::duration<double, std::nano>(best).count();
+    std::printf("%-40s %8.3f ns/item\n", name, ns / static_cast<double>(items));
+    return sum;
+}
+
+//each returns whether the checked results agreed with the reference ones
+bool varint_bench();
+bool math_bench();
@@ -0,0 +1,8 @@
+#include "bench.h"
+
+int main()
+{
+    bool ok = varint_bench();
+    ok &= math_bench();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+#include "bench.h"
+#include "../checked/checked_math.h"
+#include <cstdint>
+#include <cstdlib>
+#include <numeric>
+#include <vector>
+
+using namespace mq;
+
+namespace
+{
+template <class F>
+bool throws(F&& f)
+{
+    try
+    {
+        f();
+        return false;
+    }
+    catch (std::overflow_error&)
+    {
+        return true;
+    }
+}
+
+//the obvious implementations, one checked operation per step. `checked<T> * checked<T>` is checked in `T` itself
+template <class T>
+checked<T> naive_pow(checked<T> base, unsigned exp)
+{
+    checked<T> r = T{ 1 };
+    for (unsigned i = 0; i < exp; ++i)
+    {
+        r = r * base;
+    }
+    return r;
+}
+
+template <class T>
+checked<T> naive_isqrt(checked<T> t)
+{
+    if (t < T{ 0 })
+    {
+        throw std::overflow_error{ "Calculation overflow." };
+    }
+    long long r = 0;
+    while ((r + 1) * (r + 1) <= static_cast<long long>(static_cast<T>(t)))
+    {
+        ++r;
+    }
+    return checked<T>{ r };
+}
+
+template <class T>
+checked<T> naive_bit_ceil(checked<T> t)
+{
+    checked<T> r = T{ 1 };
+    while (r < t)
+    {
+        r = checked_cast<T>(r * 2);
+    }
+    return r;
+}
+
+template <class T>
+struct checker
+{
+    using wide = long long;
+    std::size_t mismatches = 0;
+
+    template <class F, class G>
+    void compare(const char* name, wide a, wide b, F&& f, G&& g)
+    {
+        checked<T> x{};
+        checked<T> y{};
+        const bool fx = throws([&] { x = f(); });
+        const bool gx = throws([&] { y = g(); });
+        if (fx != gx || (!fx && x != y))
+        {
+            if (mismatches++ < 10)
+            {
+                std::printf("  MISMATCH %s(%lld, %lld)\n", name, a, b);
+            }
+        }
+    }
+
+    //every value, every exponent up to 20, and every (8 bit) or every 4099th (16 bit) second operand
+    void run()
+    {
+        constexpr wide lo = std::numeric_limits<T>::min();
+        constexpr wide hi = std::numeric_limits<T>::max();
+        constexpr wide step = sizeof(T) == 1 ? 1 : 4099;
+        for (wide a = lo; a <= hi; ++a)
+        {
+            const checked<T> ca{ static_cast<T>(a) };
+            for (unsigned e = 0; e <= 20; ++e)
+            {
+                compare("pow", a, e, [&] { return checked_pow(ca, e); }, [&] { return naive_pow(ca, e); });
+            }
+            compare("abs", a, 0, [&] { return checked_abs(ca); }, [&] { return checked<T>{ std::llabs(a) }; });
+            compare("isqrt", a, 0, [&] { return checked_isqrt(ca); }, [&] { return naive_isqrt(ca); });
+            if constexpr (std::is_unsigned_v<T>)
+            {
+                compare("bit_ceil", a, 0, [&] { return checked_bit_ceil(ca); }, [&] { return naive_bit_ceil(ca); });
+            }
+            for (wide b = lo; b <= hi; b += step)
+            {
+                const checked<T> cb{ static_cast<T>(b) };
+                compare("gcd", a, b, [&] { return checked_gcd(ca, cb); }, [&] { return checked<T>{ std::gcd(a, b) }; });
+                compare("lcm", a, b, [&] { return checked_lcm(ca, cb); }, [&] { return checked<T>{ std::lcm(a, b) }; });
+                compare("midpoint", a, b, [&] { return checked_midpoint(ca, cb); }, [&] { return checked<T>{ a + (b - a) / 2 }; });
+            }
+        }
+    }
+};
+
+template <class T>
+bool check(const char* label)
+{
+    checker<T> c;
+    c.run();
+    std::printf("%s: %zu mismatches against the naive loops\n", label, c.mismatches);
+    return c.mismatches == 0;
+}
+
+//times `checked_pow` against repeated checked multiplication over every (base, exponent) of `T` that fits
+template <class T>
+void time_pow(const char* label)
+{
+    std::vector<std::pair<T, unsigned>> args;
+    for (long long b = std::numeric_limits<T>::min(); b <= std::numeric_limits<T>::max(); ++b)
+    {
+        for (unsigned e = 2; e <= 16; ++e)
+        {
+            if (throws([&] { checked_pow(checked<T>{ static_cast<T>(b) }, e); }))
+            {
+                break; //larger exponents overflow as well
+            }
+            args.emplace_back(static_cast<T>(b), e);
+        }
+    }
+    constexpr int rounds = 1000;
+    std::printf("%s, %zu calls\n", label, args.size());
+    bench("  naive pow loop", args.size() * rounds, [&]
+    {
+        long long sum = 0;
+        for (int r = 0; r < rounds; ++r)
+        {
+            for (const auto& a : args)
+            {
+                sum += static_cast<T>(naive_pow(checked<T>{ a.first }, a.second));
+            }
+        }
+        return sum;
+    });
+    bench("  checked_pow", args.size() * rounds, [&]
+    {
+        long long sum = 0;
+        for (int r = 0; r < rounds; ++r)
+        {
+            for (const auto& a : args)
+            {
+                sum += static_cast<T>(checked_pow(checked<T>{ a.first }, a.second));
+            }
+        }
+        return sum;
+    });
+}
+}
+
+bool math_bench()
+{
+    bool ok = check<std::int8_t>("int8_t");
+    ok &= check<std::uint8_t>("uint8_t");
+    ok &= check<std::int16_t>("int16_t");
+    ok &= check<std::uint16_t>("uint16_t");
+    time_pow<std::int16_t>("pow, int16_t");
+    time_pow<std::uint16_t>("pow, uint16_t");
+    return ok;
+}
@@ -0,0 +1,77 @@
+#include "bench.h"
+#include "../checked/varint.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using namespace mq;
+
+namespace
+{
+//the usual hand-written loop, trusts its input completely
+std::size_t decode_unchecked(const std::uint8_t* p, const std::uint8_t* last, std::uint32_t* out)
+{
+    std::size_t n = 0;
+    while (p != last)
+    {
+        std::uint32_t v = 0;
+        int shift = 0;
+        std::uint8_t b;
+        do
+        {
+            b = *p++;
+            v |= static_cast<std::uint32_t>(b & 0x7f) << shift;
+            shift += 7;
+        } while (b & 0x80);
+        out[n++] = v;
+    }
+    return n;
+}
+
+bool run(const char* label, int max_bits)
+{
+    constexpr std::size_t count = 1 << 20;
+    std::mt19937 gen{ 42 };
+    std::vector<std::uint8_t> buf(count * varint::max_length_v<std::uint32_t>);
+    auto end = buf.data();
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        const auto bits = std::uniform_int_distribution<int>{ 1, max_bits }(gen);
+        const auto v = static_cast<std::uint32_t>(gen() >> (32 - bits));
+        end = varint::encode(checked<std::uint32_t>{ v }, end, buf.data() + buf.size());
+    }
+    std::vector<std::uint32_t> plain(count);
+    std::vector<checked<std::uint32_t>> scalar(count);
+    std::vector<checked<std::uint32_t>> bulk(count);
+
+    std::printf("%s, %.2f bytes/value\n", label, static_cast<double>(end - buf.data()) / count);
+    bench("  unchecked loop", count, [&] { return decode_unchecked(buf.data(), end, plain.data()); });
+    bench("  varint::decode", count, [&]
+    {
+        const std::uint8_t* p = buf.data();
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            p = varint::decode(p, end, scalar[i]);
+        }
+        return p;
+    });
+    bench("  varint::decode_bulk", count, [&] { return varint::decode_bulk(buf.data(), end, bulk.data(), count).count; });
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        if (plain[i] != scalar[i] || plain[i] != bulk[i])
+        {
+            std::printf("  MISMATCH at %zu\n", i);
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+bool varint_bench()
+{
+    bool ok = run("varint, 1 byte", 7);
+    ok &= run("varint, 1-3 bytes", 21);
+    ok &= run("varint, 1-5 bytes", 32);
+    return ok;
+}
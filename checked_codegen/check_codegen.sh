@@ -0,0 +1,140 @@
+#!/bin/sh
+# Compiles codegen.cpp at -O2 and checks the disassembly of every reference function:
+# the hot path (everything up to the first ret) must stay within an instruction and a byte
+# budget and contain the expected instructions, e.g. add + jo. it may not call anything but
+# mq::detail::throw_overflow(), and its conditional branches must leave it, for the overflow
+# branch into the .cold part, instead of jumping over inline code. the function must also
+# reach throw_overflow() somewhere.
+# x86-64 only, other targets are skipped.
+set -eu
+
+CXX=${CXX:-g++}
+OBJDUMP=${OBJDUMP:-objdump}
+dir=$(cd "$(dirname "$0")" && pwd)
+
+target=$($CXX -dumpmachine)
+case $target in
+x86_64*) ;;
+*)
+    echo "check_codegen: skipped, not an x86-64 target"
+    exit 0
+    ;;
+esac
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+$CXX -std=c++17 -O2 -c "$dir/codegen.cpp" -o "$tmp/codegen.o"
+$OBJDUMP -dr --no-show-raw-insn "$tmp/codegen.o" > "$tmp/codegen.s"
+
+failed=0
+
+# summarizes the hot path of function $1 as "<instructions> <bytes> <bad calls> <inline jumps>" followed by
+# its mnemonics. relocation lines name the call and jump targets of the unlinked object, an overflow branch
+# must leave the hot path: into another section (.cold) or past the first ret
+hot_path()
+{
+    awk -v f="<$1>:" '
+    function hex(s,    i, n) {
+        n = 0
+        s = tolower(s)
+        sub(/:$/, "", s)
+        for (i = 1; i <= length(s); ++i)
+            n = n * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+        return n
+    }
+    function flush() {
+        if (pending == "")
+            return
+        if (pending ~ /^call/ && reloc !~ /throw_overflow/)
+            calls++
+        if (pending ~ /^j/ && pending !~ /^jmp/ && reloc !~ /\.text\.unlikely|\.cold/)
+            jumps[++njumps] = target
+        pending = ""
+        reloc = ""
+    }
+    $2 == f { on = 1; start = hex($1); next }
+    !on { next }
+    NF == 0 { exit }
+    $2 ~ /^R_/ { reloc = $3; next }
+    {
+        flush()
+        if (done) { end = hex($1); exit }
+        n++
+        mnems = mnems " " $2
+        pending = $2
+        target = hex($3)
+        if ($2 ~ /^ret/) { done = 1; end = hex($1) + 1 }
+    }
+    END {
+        flush()
+        for (i = 1; i <= njumps; ++i)
+            if (jumps[i] < end)
+                inline_jumps++
+        if (n)
+            print n, end - start, calls + 0, inline_jumps + 0 mnems
+    }' "$tmp/codegen.s"
+}
+
+# check <function> <max hot path instructions> <max hot path bytes> <mnemonic prefix>...
+check()
+{
+    fn=$1
+    max=$2
+    max_bytes=$3
+    shift 3
+    bad=0
+    summary=$(hot_path "$fn")
+    all=$(awk -v f="<$fn>:" -v c="<$fn.cold>:" '$2 == f || $2 == c { on = 1; next } on && NF == 0 { on = 0 } on' "$tmp/codegen.s")
+    if [ -z "$summary" ]; then
+        echo "FAIL $fn: not found"
+        failed=1
+        return 0
+    fi
+    read -r n bytes calls jumps mnems <<EOF
+$summary
+EOF
+    hot=$(echo "$mnems" | tr ' ' '\n')
+    if [ "$n" -gt "$max" ]; then
+        echo "FAIL $fn: $n instructions on the hot path, at most $max expected"
+        bad=1
+    fi
+    if [ "$bytes" -gt "$max_bytes" ]; then
+        echo "FAIL $fn: $bytes bytes of hot path, at most $max_bytes expected"
+        bad=1
+    fi
+    if [ "$calls" -ne 0 ]; then
+        echo "FAIL $fn: the hot path calls something other than throw_overflow"
+        bad=1
+    fi
+    if [ "$jumps" -ne 0 ]; then
+        echo "FAIL $fn: a conditional branch stays inside the hot path"
+        bad=1
+    fi
+    for m in "$@"; do
+        if ! echo "$hot" | grep -q "^$m"; then
+            echo "FAIL $fn: no $m on the hot path"
+            bad=1
+        fi
+    done
+    if ! echo "$all" | grep -q 'throw_overflow'; then
+        echo "FAIL $fn: does not call throw_overflow"
+        bad=1
+    fi
+    if [ $bad -eq 0 ]; then
+        echo "ok   $fn: $n instructions, $bytes bytes"
+    else
+        failed=1
+    fi
+}
+
+check add_int 4 8 add jo
+check add_unsigned 4 8 add jb
+check sub_long_int 5 12 sub jo
+check mul_int 4 8 imul jo
+check mul_unsigned_long 4 9 mul jo
+check inc_int 4 16 cmp je
+
+if [ $failed -ne 0 ]; then
+    echo "codegen check failed, see above"
+    exit 1
+fi
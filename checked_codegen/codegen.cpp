@@ -0,0 +1,39 @@
+//reference functions for check_codegen.sh, which inspects their -O2 disassembly.
+//plain `extern "C"` signatures keep the symbols easy to find
+#include "../checked/checked.h"
+
+using namespace mq;
+
+extern "C"
+{
+int add_int(int a, int b)
+{
+    return checked<int>{ a } + checked<int>{ b };
+}
+
+unsigned add_unsigned(unsigned a, unsigned b)
+{
+    return checked<unsigned>{ a } + checked<unsigned>{ b };
+}
+
+long sub_long_int(long a, int b)
+{
+    return checked<long>{ a } - checked<int>{ b };
+}
+
+int mul_int(int a, int b)
+{
+    return checked<int>{ a } * checked<int>{ b };
+}
+
+unsigned long mul_unsigned_long(unsigned long a, unsigned long b)
+{
+    return checked<unsigned long>{ a } * checked<unsigned long>{ b };
+}
+
+int inc_int(int a)
+{
+    checked<int> c{ a };
+    return ++c;
+}
+}